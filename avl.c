@@ -0,0 +1,346 @@
+// Similea Alin-Andrei 314CA
+#include "avl.h"
+
+#include "metrics.h"
+#include "vma.h"
+
+#ifdef VMA_METRICS
+__thread uint64_t avl_steps;
+#define COUNT_STEP() (avl_steps++)
+#else
+#define COUNT_STEP() ((void)0)
+#endif
+
+// Creates the tree.
+avl_t *avl_create(unsigned int data_size)
+{
+	avl_t *tree;
+
+	tree = pool_alloc(pool_get(sizeof(*tree)));
+
+	tree->root = NULL;
+	tree->data_size = data_size;
+	tree->total_elements = 0;
+	tree->pool = pool_get(sizeof(avl_node_t) + data_size);
+	tree->value_of = NULL;
+	tree->tie_of = NULL;
+
+	return tree;
+}
+
+static int avl_height(avl_node_t *node)
+{
+	return node ? node->height : 0;
+}
+
+static unsigned int avl_nr_nodes(avl_node_t *node)
+{
+	return node ? node->nr_nodes : 0;
+}
+
+// Recomputes the height, the subtree size and(if the tree keeps it) the
+// biggest value in the subtree of a node from its children.
+static void avl_update_height(avl_t *tree, avl_node_t *node)
+{
+	int left = avl_height(node->left);
+	int right = avl_height(node->right);
+
+	node->height = 1 + (left > right ? left : right);
+	node->nr_nodes = 1 + avl_nr_nodes(node->left) + avl_nr_nodes(node->right);
+
+	if (tree->value_of) {
+		node->max_value = tree->value_of(node->data);
+		if (node->left && node->left->max_value > node->max_value)
+			node->max_value = node->left->max_value;
+		if (node->right && node->right->max_value > node->max_value)
+			node->max_value = node->right->max_value;
+	}
+}
+
+// Puts "new_child" in the place of "old_child" under "parent" (or as the root
+// of the tree if there is no parent).
+static void avl_replace_child(avl_t *tree, avl_node_t *parent,
+							  avl_node_t *old_child, avl_node_t *new_child)
+{
+	if (!parent)
+		tree->root = new_child;
+	else if (parent->left == old_child)
+		parent->left = new_child;
+	else
+		parent->right = new_child;
+
+	if (new_child)
+		new_child->parent = parent;
+}
+
+static avl_node_t *avl_rotate_left(avl_t *tree, avl_node_t *x)
+{
+	avl_node_t *y = x->right;
+
+	x->right = y->left;
+	if (y->left)
+		y->left->parent = x;
+	avl_replace_child(tree, x->parent, x, y);
+	y->left = x;
+	x->parent = y;
+
+	avl_update_height(tree, x);
+	avl_update_height(tree, y);
+	return y;
+}
+
+static avl_node_t *avl_rotate_right(avl_t *tree, avl_node_t *x)
+{
+	avl_node_t *y = x->left;
+
+	x->left = y->right;
+	if (y->right)
+		y->right->parent = x;
+	avl_replace_child(tree, x->parent, x, y);
+	y->right = x;
+	x->parent = y;
+
+	avl_update_height(tree, x);
+	avl_update_height(tree, y);
+	return y;
+}
+
+// Walks up from "node" to the root, fixing heights and rotating wherever the
+// balance factor left the [-1, 1] interval.
+static void avl_rebalance(avl_t *tree, avl_node_t *node)
+{
+	while (node) {
+		avl_update_height(tree, node);
+		int balance = avl_height(node->left) - avl_height(node->right);
+
+		if (balance > 1) {
+			if (avl_height(node->left->left) < avl_height(node->left->right))
+				avl_rotate_left(tree, node->left);
+			node = avl_rotate_right(tree, node);
+		} else if (balance < -1) {
+			if (avl_height(node->right->right) <
+				avl_height(node->right->left))
+				avl_rotate_right(tree, node->right);
+			node = avl_rotate_left(tree, node);
+		}
+		node = node->parent;
+	}
+}
+
+// Tells whether a node with the given key and data goes before "node".
+static int avl_before(const avl_t *tree, uint64_t key, const void *data,
+					  const avl_node_t *node)
+{
+	if (key != node->key || !tree->tie_of)
+		return key < node->key;
+	return tree->tie_of(data) < tree->tie_of(node->data);
+}
+
+// Adds a new node with "new_data" under the given key and returns it. The keys
+// are expected to be unique(or the pairs with "tie_of").
+avl_node_t *avl_insert(avl_t *tree, uint64_t key, const void *new_data)
+{
+	avl_node_t *parent = NULL, *curr = tree->root;
+
+	while (curr) {
+		parent = curr;
+		curr = avl_before(tree, key, new_data, curr) ? curr->left : curr->right;
+	}
+
+	// The data is kept in the same pool object, right after the node.
+	avl_node_t *new_node = pool_alloc(tree->pool);
+	memcpy(new_node->data, new_data, tree->data_size);
+
+	new_node->key = key;
+	new_node->left = NULL;
+	new_node->right = NULL;
+	new_node->parent = parent;
+	new_node->height = 1;
+	new_node->nr_nodes = 1;
+	new_node->max_value = tree->value_of ? tree->value_of(new_node->data) : 0;
+
+	if (!parent)
+		tree->root = new_node;
+	else if (avl_before(tree, key, new_data, parent))
+		parent->left = new_node;
+	else
+		parent->right = new_node;
+
+	avl_rebalance(tree, parent);
+	tree->total_elements++;
+
+	return new_node;
+}
+
+// Removes the given node from the tree and frees its memory. The other nodes
+// are relinked, never copied, so pointers to them stay valid.
+void avl_remove(avl_t *tree, avl_node_t *node)
+{
+	avl_node_t *start;
+
+	if (node->left && node->right) {
+		// Put the in-order successor in the place of the removed node.
+		avl_node_t *succ = node->right;
+		while (succ->left)
+			succ = succ->left;
+
+		if (succ->parent != node) {
+			start = succ->parent;
+			avl_replace_child(tree, succ->parent, succ, succ->right);
+			succ->right = node->right;
+			succ->right->parent = succ;
+		} else {
+			start = succ;
+		}
+		avl_replace_child(tree, node->parent, node, succ);
+		succ->left = node->left;
+		succ->left->parent = succ;
+		succ->height = node->height;
+	} else {
+		start = node->parent;
+		avl_replace_child(tree, node->parent, node,
+						  node->left ? node->left : node->right);
+	}
+	avl_rebalance(tree, start);
+
+	pool_free(tree->pool, node);
+	tree->total_elements--;
+}
+
+// Returns the node with the greatest key smaller or equal to "key".
+avl_node_t *avl_floor(avl_t *tree, uint64_t key)
+{
+	avl_node_t *curr = tree->root, *best = NULL;
+
+	while (curr) {
+		COUNT_STEP();
+		if (curr->key == key && !tree->tie_of)
+			return curr;
+		if (key < curr->key) {
+			curr = curr->left;
+		} else {
+			best = curr;
+			curr = curr->right;
+		}
+	}
+	return best;
+}
+
+// Returns the node with the smallest key greater or equal to "key".
+avl_node_t *avl_ceil(avl_t *tree, uint64_t key)
+{
+	avl_node_t *curr = tree->root, *best = NULL;
+
+	while (curr) {
+		COUNT_STEP();
+		if (curr->key == key && !tree->tie_of)
+			return curr;
+		if (key > curr->key) {
+			curr = curr->right;
+		} else {
+			best = curr;
+			curr = curr->left;
+		}
+	}
+	return best;
+}
+
+// Must be called after the value of a node changed in place, so the biggest
+// values of the subtrees above it are right again.
+void avl_update_value(avl_t *tree, avl_node_t *node)
+{
+	for (; node; node = node->parent)
+		avl_update_height(tree, node);
+}
+
+// Returns how many keys of the tree are smaller than "key".
+unsigned int avl_rank(avl_t *tree, uint64_t key)
+{
+	avl_node_t *curr = tree->root;
+	unsigned int rank = 0;
+
+	while (curr) {
+		if (key <= curr->key) {
+			curr = curr->left;
+		} else {
+			rank += avl_nr_nodes(curr->left) + 1;
+			curr = curr->right;
+		}
+	}
+	return rank;
+}
+
+// Returns the node with the smallest key.
+avl_node_t *avl_first(avl_t *tree)
+{
+	avl_node_t *curr = tree->root;
+
+	if (!curr)
+		return NULL;
+	while (curr->left)
+		curr = curr->left;
+	return curr;
+}
+
+// Returns the in-order successor of the given node.
+avl_node_t *avl_next(avl_node_t *node)
+{
+	if (node->right) {
+		node = node->right;
+		while (node->left)
+			node = node->left;
+		return node;
+	}
+	while (node->parent && node->parent->right == node)
+		node = node->parent;
+	return node->parent;
+}
+
+// Returns the in-order predecessor of the given node.
+avl_node_t *avl_prev(avl_node_t *node)
+{
+	if (node->left) {
+		node = node->left;
+		while (node->right)
+			node = node->right;
+		return node;
+	}
+	while (node->parent && node->parent->left == node)
+		node = node->parent;
+	return node->parent;
+}
+
+// Returns the number of nodes in the given tree.
+unsigned int avl_get_size(avl_t *tree)
+{
+	if (!tree)
+		return 0;
+
+	return tree->total_elements;
+}
+
+// Frees the memory of the given tree.
+void avl_free(avl_t **pp_tree)
+{
+	if (!pp_tree || !*pp_tree)
+		return;
+
+	// Post-order walk without recursion: free a node once both of its
+	// subtrees are gone.
+	avl_node_t *curr = (*pp_tree)->root;
+	while (curr) {
+		if (curr->left) {
+			curr = curr->left;
+		} else if (curr->right) {
+			curr = curr->right;
+		} else {
+			avl_node_t *parent = curr->parent;
+			avl_replace_child(*pp_tree, parent, curr, NULL);
+			pool_free((*pp_tree)->pool, curr);
+			curr = parent;
+		}
+	}
+
+	pool_free(pool_get(sizeof(avl_t)), *pp_tree);
+	*pp_tree = NULL;
+}
@@ -0,0 +1,48 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+typedef struct avl_node_t {
+	struct avl_node_t *left;
+	struct avl_node_t *right;
+	struct avl_node_t *parent;
+	int height;
+	unsigned int nr_nodes;	// number of nodes in the subtree
+	uint64_t key;
+	uint64_t max_value;	 // biggest value in the subtree(see "value_of")
+	unsigned char data[];  // the data, right after the node(aligned to 8)
+} avl_node_t;
+
+typedef struct {
+	avl_node_t *root;
+	unsigned int data_size;
+	unsigned int total_elements;
+	pool_t *pool;  // nodes, each one followed by its data
+	// If set, gives a value for the data of every node and each node keeps the
+	// biggest value of its subtree, which allows searches like "the first node
+	// with a value of at least x".
+	uint64_t (*value_of)(const void *data);
+	// If set, the nodes with the same key are ordered by this value of their
+	// data, so only the pairs (key, value) have to be unique. "avl_ceil" and
+	// "avl_floor" then give the first and the last node of a key.
+	uint64_t (*tie_of)(const void *data);
+} avl_t;
+
+// ===== AVL tree functions (ordered by key) =====
+avl_t *avl_create(unsigned int data_size);
+avl_node_t *avl_insert(avl_t *tree, uint64_t key, const void *new_data);
+void avl_remove(avl_t *tree, avl_node_t *node);
+avl_node_t *avl_floor(avl_t *tree, uint64_t key);
+avl_node_t *avl_ceil(avl_t *tree, uint64_t key);
+void avl_update_value(avl_t *tree, avl_node_t *node);
+unsigned int avl_rank(avl_t *tree, uint64_t key);
+avl_node_t *avl_first(avl_t *tree);
+avl_node_t *avl_next(avl_node_t *node);
+avl_node_t *avl_prev(avl_node_t *node);
+unsigned int avl_get_size(avl_t *tree);
+void avl_free(avl_t **pp_tree);
@@ -0,0 +1,54 @@
+// Similea Alin-Andrei 314CA
+// Arena handle benchmark: creates 10^5 small arenas under their own handles,
+// allocates a few blocks in each, then destroys them all. The results go to
+// stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "vma.h"
+
+#define NR_ARENAS 100000
+#define ARENA_SIZE 4096
+#define NR_BLOCKS 4
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+	arena_table_t arenas;
+	uint64_t nr_allocs, nr_slabs;
+
+	arenas_init(&arenas);
+
+	double start = now_s();
+	for (uint64_t i = 0; i < NR_ARENAS; i++)
+		create_arena(&arenas, i, ARENA_SIZE, VMA_ENGINE_TREE);
+	double create_secs = now_s() - start;
+
+	for (uint64_t i = 0; i < NR_ARENAS; i++)
+		for (uint64_t j = 0; j < NR_BLOCKS; j++)
+			alloc_block(get_arena(&arenas, i), j * 64, 32);
+	pool_stats(&nr_allocs, &nr_slabs);
+
+	start = now_s();
+	for (uint64_t i = 0; i < NR_ARENAS; i++)
+		destroy_arena(&arenas, i);
+	double destroy_secs = now_s() - start;
+
+	fprintf(stderr, "%d arenas of %d bytes with %d blocks each\n", NR_ARENAS,
+			ARENA_SIZE, NR_BLOCKS);
+	fprintf(stderr, "create:  %12.0f arenas/s\n", NR_ARENAS / create_secs);
+	fprintf(stderr, "destroy: %12.0f arenas/s\n", NR_ARENAS / destroy_secs);
+	fprintf(stderr, "metadata: %" PRIu64 " pool allocations from %" PRIu64
+			" slabs\n", nr_allocs, nr_slabs);
+
+	destroy_all_arenas(&arenas);
+	pool_destroy_all();
+	return 0;
+}
@@ -0,0 +1,18 @@
+#!/bin/bash
+# Streams the same operations from bench/gen_ops to the driver over a pipe,
+# once as text commands and once as binary requests, and prints how many
+# operations per second each protocol handles.
+# Usage: bench/bench_binary.sh [nr_operations]
+
+cd "$(dirname "$0")/.." || exit 1
+OPS=${1:-4000000}
+
+printf "%-8s %12s %10s %14s\n" protocol operations ms "operations/s"
+for flag in "" --binary; do
+	start=$(date +%s%N)
+	bench/gen_ops $flag "$OPS" | ./vma $flag > /dev/null
+	end=$(date +%s%N)
+	ms=$(((end - start) / 1000000))
+	printf "%-8s %12d %10d %14d\n" "${flag:---text}" "$OPS" "$ms" \
+		$((OPS * 1000 / (ms > 0 ? ms : 1)))
+done
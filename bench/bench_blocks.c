@@ -0,0 +1,120 @@
+// Similea Alin-Andrei 314CA
+// Block lookup benchmark: the AVL block index of the arena against the old
+// linear walk through a list of blocks, at 10^3, 10^5 and 10^6 blocks.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "list.h"
+#include "vma.h"
+
+#define LIST_LOOKUPS 1000
+#define LIST_INSERTS 1000
+#define TREE_LOOKUPS 1000000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The lookup the arena used before the block index: walk the whole list.
+static block_t *list_find_block(list_t *list, uint64_t address)
+{
+	node_t *curr = list->head;
+	for (unsigned int i = 0; i < list->total_elements; i++) {
+		block_t *curr_block = (block_t *)curr->data;
+		uint64_t curr_ending = curr_block->start_address + curr_block->size - 1;
+		if (curr_block->start_address <= address && address <= curr_ending)
+			return curr_block;
+		curr = curr->next;
+	}
+	return NULL;
+}
+
+// Blocks of size 1 at even addresses, so no two blocks are ever merged.
+static void bench_tree(uint64_t n, double *insert_ns, double *lookup_ns)
+{
+	uint64_t *order = malloc(n * sizeof(*order));
+	DIE(!order, "malloc failed");
+	for (uint64_t i = 0; i < n; i++)
+		order[i] = i;
+	for (uint64_t i = n - 1; i > 0; i--) {
+		uint64_t j = next_rand() % (i + 1), aux = order[i];
+		order[i] = order[j];
+		order[j] = aux;
+	}
+
+	arena_t *arena = alloc_arena(2 * n);
+	double start = now_ns();
+	for (uint64_t i = 0; i < n; i++)
+		alloc_block(arena, 2 * order[i], 1);
+	*insert_ns = (now_ns() - start) / n;
+
+	uint64_t found = 0;
+	start = now_ns();
+	for (int i = 0; i < TREE_LOOKUPS; i++)
+		found += find_block(arena, 2 * (next_rand() % n), NULL) != NULL;
+	*lookup_ns = (now_ns() - start) / TREE_LOOKUPS;
+	DIE(found != TREE_LOOKUPS, "lookup failed");
+
+	dealloc_arena(arena);
+	free(order);
+}
+
+static void bench_list(uint64_t n, double *insert_ns, double *lookup_ns)
+{
+	list_t *list = ll_create(sizeof(block_t));
+	block_t block = {0, 1, NULL};
+
+	// Built back to front, so every insert is at the head.
+	for (uint64_t i = n; i > 0; i--) {
+		block.start_address = 2 * (i - 1);
+		ll_add_nth_node(list, 0, &block);
+	}
+
+	uint64_t found = 0;
+	double start = now_ns();
+	for (int i = 0; i < LIST_LOOKUPS; i++)
+		found += list_find_block(list, 2 * (next_rand() % n)) != NULL;
+	*lookup_ns = (now_ns() - start) / LIST_LOOKUPS;
+	DIE(found != LIST_LOOKUPS, "lookup failed");
+
+	// Inserting in the middle of the list, as alloc_block used to do.
+	start = now_ns();
+	for (int i = 0; i < LIST_INSERTS; i++) {
+		block.start_address = 2 * n + i;
+		ll_add_nth_node(list, next_rand() % list->total_elements, &block);
+	}
+	*insert_ns = (now_ns() - start) / LIST_INSERTS;
+
+	ll_free(&list);
+}
+
+int main(void)
+{
+	uint64_t sizes[] = {1000, 100000, 1000000};
+
+	printf("%10s %14s %14s %14s %14s %10s\n", "blocks", "list ins ns",
+		   "tree ins ns", "list find ns", "tree find ns", "speedup");
+	for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		double list_ins, list_find, tree_ins, tree_find;
+
+		bench_list(sizes[i], &list_ins, &list_find);
+		bench_tree(sizes[i], &tree_ins, &tree_find);
+		printf("%10" PRIu64 " %14.1f %14.1f %14.1f %14.1f %9.1fx\n", sizes[i],
+			   list_ins, tree_ins, list_find, tree_find, list_find / tree_find);
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+// Similea Alin-Andrei 314CA
+// Bulk operations benchmark: MEMCPY, MEMSET and MEMCMP on zones of 4 KiB to 16
+// MiB(in a block of 256 MiB, the source written), against doing the same
+// through the client: a READ of the zone into a buffer and a WRITE of it back
+// (the formatting of the commands isn't counted). The results, in GB/s, go to
+// stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "bulk.h"
+#include "vma.h"
+
+#define BLOCK_SIZE (256UL << 20)
+#define MAX_ZONE (16UL << 20)
+#define BYTES_PER_SIZE (1UL << 30)	// the bytes moved for each zone size
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// A READ and a WRITE of the zone, with the bytes going through "buffer".
+static void round_trip(arena_t *arena, uint64_t dest, uint64_t src,
+					   uint64_t size, uint8_t *buffer)
+{
+	uint64_t done;
+
+	DIE(read_source(arena, src, size, &done) != VMA_OK, "read failed");
+	copy_bytes(arena, src, size, buffer);
+	release_range(arena, src, size);
+	DIE(write(arena, dest, size, (int8_t *)buffer) != VMA_OK, "write failed");
+}
+
+static double gbps(uint64_t bytes, double ns)
+{
+	return bytes / ns;
+}
+
+int main(void)
+{
+	arena_t *arena = alloc_arena(BLOCK_SIZE);
+	uint8_t *buffer = malloc(MAX_ZONE);
+	uint64_t src = 0, dest = BLOCK_SIZE / 2, done;
+	int result;
+
+	DIE(!buffer, "malloc failed");
+	alloc_block(arena, 0, BLOCK_SIZE);
+	for (uint64_t i = 0; i < MAX_ZONE; i++)
+		buffer[i] = 'a' + next_rand() % 26;
+	write(arena, src, MAX_ZONE, (int8_t *)buffer);
+
+	fprintf(stderr, "%10s %10s %10s %10s %10s %10s\n", "zone", "MEMCPY",
+			"READ+WRITE", "MEMSET", "WRITE", "MEMCMP");
+	for (uint64_t size = 4096; size <= MAX_ZONE; size *= 16) {
+		uint64_t reps = BYTES_PER_SIZE / size;
+		double start = now_ns();
+		for (uint64_t i = 0; i < reps; i++)
+			DIE(bulk_copy(arena, dest, src, size, 0, &done) != VMA_OK,
+				"copy failed");
+		double copy_ns = now_ns() - start;
+
+		start = now_ns();
+		for (uint64_t i = 0; i < reps; i++)
+			round_trip(arena, dest, src, size, buffer);
+		double trip_ns = now_ns() - start;
+
+		start = now_ns();
+		for (uint64_t i = 0; i < reps; i++)
+			bulk_set(arena, dest, size, 'x', &done);
+		double set_ns = now_ns() - start;
+
+		memset(buffer, 'x', size);
+		start = now_ns();
+		for (uint64_t i = 0; i < reps; i++)
+			write(arena, dest, size, (int8_t *)buffer);
+		double write_ns = now_ns() - start;
+
+		bulk_copy(arena, dest, src, size, 0, &done);
+		start = now_ns();
+		for (uint64_t i = 0; i < reps; i++)
+			bulk_compare(arena, dest, src, size, &result, &done);
+		double cmp_ns = now_ns() - start;
+		DIE(result != 0, "the copy differs");
+
+		fprintf(stderr, "%9luK %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+				size >> 10, gbps(BYTES_PER_SIZE, copy_ns),
+				gbps(BYTES_PER_SIZE, trip_ns), gbps(BYTES_PER_SIZE, set_ns),
+				gbps(BYTES_PER_SIZE, write_ns), gbps(BYTES_PER_SIZE, cmp_ns));
+	}
+
+	free(buffer);
+	dealloc_arena(arena);
+	pool_destroy_all();
+	return 0;
+}
@@ -0,0 +1,103 @@
+// Similea Alin-Andrei 314CA
+// Checkpoint benchmark: an arena of 1 GiB with a block of 3 miniblocks(3 KiB
+// written) on every page is built by replaying its ALLOC_BLOCKs and WRITEs,
+// saved, then loaded back. Prints the time of the replay, of SAVE, of LOAD and
+// of LOAD followed by a read of every page(the pages only come from the file
+// when they are touched). The file goes to the given path(/tmp by default).
+// The results go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "checkpoint.h"
+#include "mem.h"
+#include "vma.h"
+
+#define ARENA_SIZE (1ULL << 30)
+#define MINIB_SIZE 1024
+#define NR_MINIB 3	// on every page
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static arena_t *replay(void)
+{
+	int8_t data[NR_MINIB * MINIB_SIZE];
+	arena_t *arena = alloc_arena(ARENA_SIZE);
+
+	for (size_t i = 0; i < sizeof(data); i++)
+		data[i] = 'a' + next_rand() % 26;
+	for (uint64_t page = 0; page < ARENA_SIZE / VMA_PAGE_SIZE; page++) {
+		uint64_t address = page * VMA_PAGE_SIZE;
+		for (int i = 0; i < NR_MINIB; i++)
+			alloc_block(arena, address + i * MINIB_SIZE, MINIB_SIZE);
+		data[0] = 'a' + page % 26;
+		write(arena, address, sizeof(data), data);
+	}
+	return arena;
+}
+
+// Reads a byte of every page, so all of them are brought in.
+static uint64_t touch_pages(arena_t *arena)
+{
+	uint64_t sum = 0;
+
+	for (uint64_t page = 0; page < ARENA_SIZE / VMA_PAGE_SIZE; page++)
+		sum += page_data(arena, page)[0] == 'a' + page % 26;
+	return sum;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : "/tmp/bench_checkpoint.ckpt";
+	arena_t *arena, *loaded;
+
+	double start = now_ns();
+	arena = replay();
+	double replay_ms = (now_ns() - start) / 1e6;
+
+	start = now_ns();
+	DIE(save_checkpoint(arena, path) != VMA_OK, "save failed");
+	double save_ms = (now_ns() - start) / 1e6;
+
+	start = now_ns();
+	DIE(load_checkpoint(path, &loaded) != VMA_OK, "load failed");
+	double load_ms = (now_ns() - start) / 1e6;
+	uint64_t touched = touch_pages(loaded);
+	double touch_ms = (now_ns() - start) / 1e6;
+	DIE(touched != ARENA_SIZE / VMA_PAGE_SIZE, "wrong bytes after load");
+
+	FILE *file = fopen(path, "rb");
+	DIE(!file, "fopen failed");
+	uint64_t file_len = file_size(file);
+	fclose(file);
+
+	fprintf(stderr, "arena: %llu MiB, %llu miniblocks, file: %lu MiB\n",
+			ARENA_SIZE >> 20, ARENA_SIZE / VMA_PAGE_SIZE * NR_MINIB,
+			file_len >> 20);
+	fprintf(stderr, "%-24s %10.1f ms\n", "replay", replay_ms);
+	fprintf(stderr, "%-24s %10.1f ms\n", "save", save_ms);
+	fprintf(stderr, "%-24s %10.1f ms\n", "load", load_ms);
+	fprintf(stderr, "%-24s %10.1f ms\n", "load + touch every page",
+			touch_ms);
+
+	dealloc_arena(arena);
+	dealloc_arena(loaded);
+	remove(path);
+	pool_destroy_all();
+	return 0;
+}
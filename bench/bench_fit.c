@@ -0,0 +1,144 @@
+// Similea Alin-Andrei 314CA
+// Automatic placement benchmark: ALLOC_AUTO with each policy on an arena with
+// 10^3, 10^4 and 10^5 live blocks and as many free zones between them, against
+// finding the first free zone with a walk through the tree of blocks(what the
+// arena had to do without the index of free zones). Each round frees a random
+// block and allocates one of another random size. The first fit of the index
+// is checked against the walk. The results go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "gaps.h"
+#include "vma.h"
+
+#define NR_ROUNDS 100000
+#define WALK_ROUNDS 1000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The first free zone of at least "size" bytes, found by walking the blocks.
+static int walk_first_fit(arena_t *arena, uint64_t size, uint64_t *address)
+{
+	uint64_t free_start = 0;
+
+	for (avl_node_t *curr = avl_first(arena->alloc_tree); curr;
+		 curr = avl_next(curr)) {
+		block_t *block = (block_t *)curr->data;
+		if (block->start_address - free_start >= size) {
+			*address = free_start;
+			return 1;
+		}
+		free_start = block->start_address + block->size;
+	}
+	if (arena->arena_size - free_start < size)
+		return 0;
+	*address = free_start;
+	return 1;
+}
+
+// Blocks of 32 to 63 bytes with free zones of 1 to 32 bytes between them, so
+// most of the zones are too small for a new block.
+static arena_t *fragmented_arena(uint64_t n, uint64_t *addresses)
+{
+	arena_t *arena = alloc_arena(n * 128 + 4096);
+	uint64_t address = 0;
+
+	for (uint64_t i = 0; i < n; i++) {
+		address += next_rand() % 32 + 1;
+		addresses[i] = address;
+		alloc_block(arena, address, next_rand() % 32 + 32);
+		address += 64;
+	}
+	return arena;
+}
+
+// Frees a random block and allocates a new one, "rounds" times. The freed
+// block is always one placed by "fragmented_arena" or by an earlier round.
+static double run_rounds(arena_t *arena, uint64_t *addresses, uint64_t n,
+						 int fit, int rounds, int walk)
+{
+	uint64_t address;
+	double start = now_ns();
+
+	for (int i = 0; i < rounds; i++) {
+		uint64_t victim = next_rand() % n;
+		uint64_t size = next_rand() % 32 + 32;
+
+		free_block(arena, addresses[victim]);
+		if (walk) {
+			DIE(!walk_first_fit(arena, size, &address), "no zone found");
+			alloc_block(arena, address, size);
+		} else {
+			DIE(alloc_auto(arena, size, 1, fit, &address) != VMA_OK,
+				"no zone found");
+		}
+		addresses[victim] = address;
+	}
+	return (now_ns() - start) / rounds;
+}
+
+// The same rounds with the first fit of the index, untimed, each one checked
+// against the walk.
+static void check_first_fit(arena_t *arena, uint64_t *addresses, uint64_t n)
+{
+	uint64_t address, expected;
+
+	for (int i = 0; i < WALK_ROUNDS; i++) {
+		uint64_t victim = next_rand() % n;
+		uint64_t size = next_rand() % 32 + 32;
+
+		free_block(arena, addresses[victim]);
+		DIE(!walk_first_fit(arena, size, &expected), "no zone found");
+		DIE(alloc_auto(arena, size, 1, VMA_FIRST_FIT, &address) != VMA_OK ||
+			address != expected, "the first fit differs");
+		addresses[victim] = address;
+	}
+}
+
+int main(void)
+{
+	uint64_t sizes[] = {1000, 10000, 100000};
+
+	fprintf(stderr, "%10s %12s %12s %12s %12s\n", "blocks", "walk ns/op",
+			"first ns/op", "best ns/op", "next ns/op");
+	for (int s = 0; s < 3; s++) {
+		uint64_t n = sizes[s];
+		uint64_t *addresses = malloc(n * sizeof(*addresses));
+		DIE(!addresses, "malloc failed");
+
+		arena_t *arena = fragmented_arena(n, addresses);
+		fprintf(stderr, "%10lu %12.0f", n,
+				run_rounds(arena, addresses, n, VMA_FIRST_FIT, WALK_ROUNDS, 1));
+		dealloc_arena(arena);
+
+		for (int fit = 0; fit < VMA_NR_FITS; fit++) {
+			arena = fragmented_arena(n, addresses);
+			double ns = run_rounds(arena, addresses, n, fit, NR_ROUNDS, 0);
+			fprintf(stderr, " %12.0f", ns);
+			if (fit == VMA_FIRST_FIT)
+				check_first_fit(arena, addresses, n);
+			dealloc_arena(arena);
+		}
+		fprintf(stderr, "\n");
+		free(addresses);
+	}
+
+	pool_destroy_all();
+	return 0;
+}
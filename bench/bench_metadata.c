@@ -0,0 +1,57 @@
+// Similea Alin-Andrei 314CA
+// Metadata benchmark: the heap used per miniblock by 10^6 miniblocks of 64
+// bytes, all in one block(they are allocated next to each other) and each in
+// its own block(a free page between them), next to the size of the objects
+// that make up a miniblock. The data of the arena isn't counted. The results
+// go to stderr.
+#define _GNU_SOURCE	 // mallinfo2
+#include <malloc.h>
+#include <time.h>
+
+#include "vma.h"
+
+#define NR_MINIBLOCKS 1000000
+#define MINIB_SIZE 64
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_layout(const char *name, uint64_t step)
+{
+	arena_t *arena = alloc_arena((uint64_t)NR_MINIBLOCKS * step);
+	size_t before = mallinfo2().uordblks;
+
+	double start = now_ns();
+	for (uint64_t i = 0; i < NR_MINIBLOCKS; i++)
+		DIE(alloc_block(arena, i * step, MINIB_SIZE) != VMA_OK,
+			"alloc_block failed");
+	double ns = (now_ns() - start) / NR_MINIBLOCKS;
+
+	size_t used = mallinfo2().uordblks - before;
+	fprintf(stderr, "%-16s %10u %14.1f %12.1f\n", name,
+			avl_get_size(arena->minib_index),
+			(double)used / NR_MINIBLOCKS, ns);
+	dealloc_arena(arena);
+	pool_destroy_all();
+}
+
+int main(void)
+{
+	fprintf(stderr, "list node + miniblock: %zu bytes\n",
+			sizeof(node_t) + sizeof(miniblock_t));
+	fprintf(stderr, "index node + pointer:  %zu bytes\n",
+			sizeof(avl_node_t) + sizeof(node_t *));
+	fprintf(stderr, "tree node + block:     %zu bytes\n\n",
+			sizeof(avl_node_t) + sizeof(block_t));
+
+	fprintf(stderr, "%-16s %10s %14s %12s\n", "layout", "miniblocks",
+			"bytes/minib", "ns/alloc");
+	bench_layout("one block", MINIB_SIZE);
+	bench_layout("one per block", VMA_PAGE_SIZE);
+	return 0;
+}
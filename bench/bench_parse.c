@@ -0,0 +1,151 @@
+// Similea Alin-Andrei 314CA
+// Command parsing benchmark: 10^7 small commands, read through the buffered
+// reader and parsed the old way(a copy of the line, "strtok" twice, a chain of
+// "strcmp" and "atol") and through "parse_command". Only the parsing is timed,
+// the commands are not run. The results go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "vma.h"
+
+#define NR_COMMANDS 10000000UL
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The parsing of the commands as it was before "parse_command".
+static int old_command_type(char *command)
+{
+	if (strcmp(command, "ALLOC_ARENA") == 0)
+		return 1;
+	if (strcmp(command, "DEALLOC_ARENA") == 0)
+		return 2;
+	if (strcmp(command, "ALLOC_BLOCK") == 0)
+		return 3;
+	if (strcmp(command, "FREE_BLOCK") == 0)
+		return 4;
+	if (strcmp(command, "READ") == 0)
+		return 5;
+	if (strcmp(command, "WRITE") == 0)
+		return 6;
+	if (strcmp(command, "PMAP") == 0)
+		return 7;
+	if (strcmp(command, "MPROTECT") == 0)
+		return 8;
+	return 0;
+}
+
+static int old_nr_of_parameters(char *line, char *delim)
+{
+	int nr = 0;
+	char *word = strtok(line, delim);
+
+	while (word) {
+		nr++;
+		word = strtok(NULL, delim);
+	}
+
+	return nr;
+}
+
+static uint64_t parse_old(char *trace, size_t trace_len)
+{
+	char delim[] = "\n ";
+	char *line, *line_copy = NULL;
+	size_t line_len, copy_size = 0;
+	uint64_t sum = 0;
+	input_t in;
+
+	FILE *file = fmemopen(trace, trace_len, "r");
+	DIE(!file, "fmemopen failed");
+	input_init(&in, file);
+
+	while ((line = input_line(&in, &line_len))) {
+		if (line_len + 1 > copy_size) {
+			copy_size = line_len + 1;
+			line_copy = realloc(line_copy, copy_size);
+			DIE(!line_copy, "realloc failed");
+		}
+		memcpy(line_copy, line, line_len + 1);
+
+		int nr_param = old_nr_of_parameters(line_copy, delim);
+		int type = old_command_type(strtok(line, delim));
+		sum += type + nr_param;
+		for (int i = 1; i < nr_param && i < 3; i++)
+			sum += atol(strtok(NULL, delim));
+	}
+
+	free(line_copy);
+	input_destroy(&in);
+	fclose(file);
+	return sum;
+}
+
+static uint64_t parse_new(char *trace, size_t trace_len)
+{
+	char *line;
+	size_t line_len;
+	command_t cmd;
+	uint64_t sum = 0;
+	input_t in;
+
+	FILE *file = fmemopen(trace, trace_len, "r");
+	DIE(!file, "fmemopen failed");
+	input_init(&in, file);
+
+	while ((line = input_line(&in, &line_len))) {
+		parse_command(line, line_len, &cmd);
+		sum += cmd.type + cmd.nr_param;
+		for (int i = 1; i < cmd.nr_param && i < 3; i++)
+			sum += command_number(&cmd, i);
+	}
+
+	input_destroy(&in);
+	fclose(file);
+	return sum;
+}
+
+int main(void)
+{
+	const char *formats[] = {
+		"ALLOC_BLOCK %lu %lu\n", "FREE_BLOCK %lu\n", "READ %lu %lu\n",
+		"MPROTECT %lu PROT_READ | PROT_WRITE\n", "PMAP\n",
+	};
+	size_t capacity = NR_COMMANDS * 32, trace_len = 0;
+	char *trace = malloc(capacity);
+	DIE(!trace, "malloc failed");
+
+	for (unsigned long i = 0; i < NR_COMMANDS; i++)
+		trace_len += sprintf(trace + trace_len, formats[i % 5],
+							 (i * 7919) % 1000000, i % 4096 + 1);
+
+	// Both parsers change the lines in place, so each one gets a copy.
+	char *copy = malloc(trace_len);
+	DIE(!copy, "malloc failed");
+
+	fprintf(stderr, "%10s %14s\n", "parser", "commands/s");
+
+	memcpy(copy, trace, trace_len);
+	double start = now_s();
+	uint64_t sum_old = parse_old(copy, trace_len);
+	double secs = now_s() - start;
+	fprintf(stderr, "%10s %14.0f\n", "old", NR_COMMANDS / secs);
+
+	memcpy(copy, trace, trace_len);
+	start = now_s();
+	uint64_t sum_new = parse_new(copy, trace_len);
+	secs = now_s() - start;
+	fprintf(stderr, "%10s %14.0f\n", "new", NR_COMMANDS / secs);
+
+	DIE(sum_old != sum_new, "the parsers disagree");
+
+	free(copy);
+	free(trace);
+	pool_destroy_all();
+	return 0;
+}
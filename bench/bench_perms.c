@@ -0,0 +1,81 @@
+// Similea Alin-Andrei 314CA
+// Permission check benchmark: the checks of READs of 16 bytes to 64 KiB in a
+// block of 10^5 miniblocks, with the table of page permissions, against the
+// old walk through the miniblocks(from the first one read to the end of the
+// block). Half of the pages get their permissions with a range MPROTECT, so
+// the miniblocks there are cut at the page borders. The results go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "perms.h"
+#include "vma.h"
+
+#define NR_MINIBLOCKS 100000
+#define MINIBLOCK_SIZE 100
+#define NR_CHECKS 100000
+#define WALK_CHECKS 1000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The check as it was before the table: every miniblock from the first one up
+// to the end of the block.
+static int old_check(node_t *minib_node, int mode)
+{
+	for (node_t *curr = minib_node; curr; curr = curr->next)
+		if ((((miniblock_t *)curr->data)->perm & mode) == 0)
+			return 0;
+	return 1;
+}
+
+int main(void)
+{
+	uint64_t arena_size = (uint64_t)NR_MINIBLOCKS * MINIBLOCK_SIZE;
+	arena_t *arena = alloc_arena(arena_size);
+
+	for (uint64_t i = 0; i < NR_MINIBLOCKS; i++)
+		alloc_block(arena, i * MINIBLOCK_SIZE, MINIBLOCK_SIZE);
+	for (uint64_t page = 0; page < arena_size / VMA_PAGE_SIZE; page += 2)
+		mprotect_range(arena, page * VMA_PAGE_SIZE, VMA_PAGE_SIZE, 4);
+
+	fprintf(stderr, "%10s %14s %14s\n", "read size", "walk ns/check",
+			"table ns/check");
+	for (uint64_t size = 16; size <= 65536; size *= 16) {
+		uint64_t allowed = 0;
+		double start = now_ns();
+		for (int i = 0; i < WALK_CHECKS; i++) {
+			uint64_t address = next_rand() % (arena_size - size);
+			allowed += old_check(find_miniblock(arena, address), 4);
+		}
+		double walk_ns = (now_ns() - start) / WALK_CHECKS;
+
+		start = now_ns();
+		for (int i = 0; i < NR_CHECKS; i++) {
+			uint64_t address = next_rand() % (arena_size - size);
+			allowed += perms_check(arena, address, size, 4);
+		}
+		double table_ns = (now_ns() - start) / NR_CHECKS;
+
+		DIE(allowed != WALK_CHECKS + NR_CHECKS, "a read was refused");
+		fprintf(stderr, "%10lu %14.0f %14.0f\n", size, walk_ns, table_ns);
+	}
+
+	dealloc_arena(arena);
+	pool_destroy_all();
+	return 0;
+}
@@ -0,0 +1,39 @@
+#!/bin/bash
+# Runs a big trace of text commands from bench/gen_ops through the serial
+# driver and through the pipelined one(--pipeline), both reading it from the
+# same file, and prints how many operations per second each one handles(the
+# best of a few runs). The two outputs must be the same, byte for byte. The
+# stages of the pipeline only run side by side with a processor for each one.
+# Usage: bench/bench_pipeline.sh [nr_operations [nr_runs]]
+
+cd "$(dirname "$0")/.." || exit 1
+OPS=${1:-4000000}
+RUNS=${2:-3}
+trace=$(mktemp)
+serial=$(mktemp)
+pipelined=$(mktemp)
+trap 'rm -f "$trace" "$serial" "$pipelined"' EXIT
+
+bench/gen_ops "$OPS" > "$trace"
+echo "processors: $(nproc)"
+printf "%-10s %12s %10s %14s\n" driver operations ms "operations/s"
+for flag in "" --pipeline; do
+	out=$serial
+	[ -n "$flag" ] && out=$pipelined
+	best=0
+	for ((run = 0; run < RUNS; run++)); do
+		start=$(date +%s%N)
+		./vma $flag < "$trace" > "$out"
+		end=$(date +%s%N)
+		ms=$(((end - start) / 1000000))
+		((best == 0 || ms < best)) && best=$ms
+	done
+	printf "%-10s %12d %10d %14d\n" "${flag:---serial}" "$OPS" "$best" \
+		$((OPS * 1000 / (best > 0 ? best : 1)))
+done
+
+if ! cmp -s "$serial" "$pipelined"; then
+	echo "the outputs differ" >&2
+	exit 1
+fi
+echo "same output: $(wc -c < "$serial") bytes"
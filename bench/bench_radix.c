@@ -0,0 +1,83 @@
+// Similea Alin-Andrei 314CA
+// Translation benchmark: finding the block and the miniblock of random
+// addresses in an arena of 2^40 bytes with 10^3 to 10^6 blocks of 4 pages
+// (a free page between them), with the trees alone and with the page table of
+// the radix engine. The results go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "radix.h"
+#include "vma.h"
+
+#define ARENA_SIZE (1ULL << 40)
+#define BLOCK_PAGES 4
+#define NR_LOOKUPS 1000000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Spreads the blocks over the whole arena, so the page table has tables on
+// every level.
+static uint64_t block_address(uint64_t i, uint64_t n)
+{
+	uint64_t step = ARENA_SIZE / n / VMA_PAGE_SIZE * VMA_PAGE_SIZE;
+
+	return i * step;
+}
+
+static double bench_lookups(uint64_t n, int engine, uint64_t *nr_tables)
+{
+	arena_t *arena = alloc_arena(ARENA_SIZE);
+	if (engine == VMA_ENGINE_RADIX)
+		make_radix(arena);
+
+	for (uint64_t i = 0; i < n; i++)
+		alloc_block(arena, block_address(i, n), BLOCK_PAGES * VMA_PAGE_SIZE);
+	*nr_tables = arena->radix ? arena->radix->nr_tables : 0;
+
+	uint64_t found = 0;
+	double start = now_ns();
+	for (int i = 0; i < NR_LOOKUPS; i++) {
+		uint64_t address = block_address(next_rand() % n, n) +
+						   next_rand() % (BLOCK_PAGES * VMA_PAGE_SIZE);
+		found += find_block(arena, address, NULL) &&
+				 find_miniblock(arena, address);
+	}
+	double ns = (now_ns() - start) / NR_LOOKUPS;
+	DIE(found != NR_LOOKUPS, "lookup failed");
+
+	dealloc_arena(arena);
+	return ns;
+}
+
+int main(void)
+{
+	uint64_t nr_tables;
+
+	fprintf(stderr, "%10s %12s %12s %10s\n", "blocks", "tree ns", "radix ns",
+			"tables");
+	for (uint64_t n = 1000; n <= 1000000; n *= 10) {
+		double tree_ns = bench_lookups(n, VMA_ENGINE_TREE, &nr_tables);
+		double radix_ns = bench_lookups(n, VMA_ENGINE_RADIX, &nr_tables);
+		fprintf(stderr, "%10lu %12.1f %12.1f %10lu\n", n, tree_ns, radix_ns,
+				nr_tables);
+	}
+
+	pool_destroy_all();
+	return 0;
+}
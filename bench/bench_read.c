@@ -0,0 +1,56 @@
+// Similea Alin-Andrei 314CA
+// READ throughput benchmark: reads of different sizes from a fully written
+// block, with the output going to /dev/null. The results go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "vma.h"
+
+#define BLOCK_SIZE (64UL << 20)
+#define MIN_BYTES (256UL << 20)	 // bytes read for every size
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+	uint64_t sizes[] = {16, 256, 4096, 65536, 1UL << 20, 16UL << 20};
+
+	DIE(!freopen("/dev/null", "w", stdout), "freopen failed");
+	setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+
+	arena_t *arena = alloc_arena(BLOCK_SIZE);
+	alloc_block(arena, 0, BLOCK_SIZE);
+
+	int8_t *data = malloc(BLOCK_SIZE);
+	DIE(!data, "malloc failed");
+	for (uint64_t i = 0; i < BLOCK_SIZE; i++)
+		data[i] = 'a' + i % 26;
+	write(arena, 0, BLOCK_SIZE, data);
+	free(data);
+
+	fprintf(stderr, "%12s %12s %12s\n", "read size", "reads/s", "MB/s");
+	for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		uint64_t nr_reads = MIN_BYTES / sizes[i];
+		if (nr_reads > 2000000)
+			nr_reads = 2000000;
+
+		double start = now_s();
+		for (uint64_t j = 0; j < nr_reads; j++)
+			read(arena, (j * 4099) % (BLOCK_SIZE - sizes[i]), sizes[i],
+				 stdout);
+		fflush(stdout);
+		double secs = now_s() - start;
+
+		fprintf(stderr, "%12" PRIu64 " %12.0f %12.1f\n", sizes[i],
+				nr_reads / secs, nr_reads * sizes[i] / secs / 1e6);
+	}
+
+	dealloc_arena(arena);
+	return 0;
+}
@@ -0,0 +1,99 @@
+// Similea Alin-Andrei 314CA
+// Snapshot benchmark, on a concurrent arena with 10^5 blocks of 2 miniblocks:
+// how long a PMAP keeps the tree lock(and so the writers) waiting when it
+// prints while holding it, as it used to, against the time to build the
+// snapshot it prints from now, and the cost of taking the same snapshot again
+// while the arena doesn't change. The output of PMAP goes to /dev/null, the
+// results to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "snapshot.h"
+#include "vma.h"
+
+#define NR_BLOCKS 100000
+#define REPS 20
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// The PMAP that prints while holding the tree lock.
+static void locked_pmap(arena_t *arena)
+{
+	lock_tree(arena->locks, 0);
+	avl_node_t *curr_node_b = avl_first(arena->alloc_tree);
+	for (unsigned int i = 0; curr_node_b; i++) {
+		block_t *curr_block = (block_t *)curr_node_b->data;
+		list_t *miniblock_list = (list_t *)curr_block->miniblock_list;
+		printf("\nBlock %d begin\n", i + 1);
+		printf("Zone: 0x%lX - 0x%lX\n", curr_block->start_address,
+			   curr_block->start_address + curr_block->size);
+		for (node_t *curr = miniblock_list->head; curr; curr = curr->next) {
+			miniblock_t *minib = (miniblock_t *)curr->data;
+			printf("Miniblock:\t\t0x%lX\t\t-\t\t0x%lX\t\t| ",
+				   minib->start_address,
+				   minib->start_address + minib->size);
+			print_permissions(minib->perm, stdout);
+		}
+		printf("Block %d end\n", i + 1);
+		curr_node_b = avl_next(curr_node_b);
+	}
+	fflush(stdout);
+	unlock_tree(arena->locks);
+}
+
+int main(void)
+{
+	DIE(!freopen("/dev/null", "w", stdout), "freopen failed");
+
+	arena_t *arena = alloc_arena(NR_BLOCKS * 64UL);
+	make_concurrent(arena);
+	for (uint64_t i = 0; i < NR_BLOCKS; i++) {
+		alloc_block(arena, i * 64, 16);
+		alloc_block(arena, i * 64 + 16, 16);
+	}
+
+	double locked = 0, build = 0, cached = 0, unlocked_pmap = 0;
+	for (int r = 0; r < REPS; r++) {
+		double start = now_us();
+		locked_pmap(arena);
+		locked += now_us() - start;
+
+		// A change, so the next snapshot has to be built.
+		mprotect(arena, 0, r % 2 ? 6 : 4);
+		start = now_us();
+		snapshot_t *snap = take_snapshot(arena);
+		build += now_us() - start;
+		drop_snapshot(snap);
+
+		start = now_us();
+		snap = take_snapshot(arena);
+		cached += now_us() - start;
+		drop_snapshot(snap);
+
+		start = now_us();
+		pmap(arena, 0, stdout);
+		fflush(stdout);
+		unlocked_pmap += now_us() - start;
+	}
+
+	fprintf(stderr, "%d blocks, %d miniblocks, average of %d runs\n",
+			NR_BLOCKS, 2 * NR_BLOCKS, REPS);
+	fprintf(stderr, "PMAP printing under the tree lock: %10.0f us locked\n",
+			locked / REPS);
+	fprintf(stderr, "a new snapshot after one change:   %10.0f us locked\n",
+			build / REPS);
+	fprintf(stderr, "taking the same snapshot again:    %10.2f us\n",
+			cached / REPS);
+	fprintf(stderr, "PMAP from a snapshot(no lock):     %10.0f us\n",
+			unlocked_pmap / REPS);
+
+	dealloc_arena(arena);
+	pool_destroy_all();
+	return 0;
+}
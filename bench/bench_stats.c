@@ -0,0 +1,96 @@
+// Similea Alin-Andrei 314CA
+// Statistics benchmark: reading the counters of an arena(STATS) with 10^3 to
+// 10^6 blocks of 2 miniblocks, against finding the same numbers with a walk
+// through the blocks and their miniblocks, like PMAP did. The results go to
+// stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "vma.h"
+
+#define BLOCK_STEP 4096	 // a block of 2 miniblocks of 1 KiB every 4 KiB
+#define NR_READS 1000000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The counters found the old way.
+static void walk_stats(arena_t *arena, arena_stats_t *stats)
+{
+	uint64_t prev_end = 0;
+
+	stats->total_memory = arena->arena_size;
+	stats->allocated_memory = 0;
+	stats->nr_blocks = 0;
+	stats->nr_miniblocks = 0;
+	stats->largest_free_zone = 0;
+	for (avl_node_t *node = avl_first(arena->alloc_tree); node;
+		 node = avl_next(node)) {
+		block_t *block = (block_t *)node->data;
+		list_t *miniblock_list = (list_t *)block->miniblock_list;
+
+		if (block->start_address - prev_end > stats->largest_free_zone)
+			stats->largest_free_zone = block->start_address - prev_end;
+		prev_end = block->start_address + block->size;
+		stats->allocated_memory += block->size;
+		stats->nr_blocks++;
+		for (node_t *curr = miniblock_list->head; curr; curr = curr->next)
+			stats->nr_miniblocks++;
+	}
+	if (arena->arena_size - prev_end > stats->largest_free_zone)
+		stats->largest_free_zone = arena->arena_size - prev_end;
+	stats->free_memory = arena->arena_size - stats->allocated_memory;
+}
+
+int main(void)
+{
+	arena_stats_t stats, walked;
+
+	fprintf(stderr, "%10s %14s %14s\n", "blocks", "walk ns", "counters ns");
+	for (uint64_t n = 1000; n <= 1000000; n *= 10) {
+		arena_t *arena = alloc_arena((n + 1) * BLOCK_STEP);
+		for (uint64_t i = 0; i < n; i++) {
+			alloc_block(arena, i * BLOCK_STEP, 1024);
+			alloc_block(arena, i * BLOCK_STEP + 1024, 1024);
+		}
+		// A bigger hole somewhere, so the largest free zone means something.
+		free_block(arena, next_rand() % n * BLOCK_STEP + 1024);
+
+		int nr_walks = n < 100000 ? 100 : 10;
+		double start = now_ns();
+		for (int i = 0; i < nr_walks; i++)
+			walk_stats(arena, &walked);
+		double walk_ns = (now_ns() - start) / nr_walks;
+
+		start = now_ns();
+		for (int i = 0; i < NR_READS; i++)
+			arena_stats(arena, &stats);
+		double stats_ns = (now_ns() - start) / NR_READS;
+
+		DIE(stats.allocated_memory != walked.allocated_memory ||
+			stats.nr_blocks != walked.nr_blocks ||
+			stats.nr_miniblocks != walked.nr_miniblocks ||
+			stats.largest_free_zone != walked.largest_free_zone,
+			"the counters are wrong");
+		fprintf(stderr, "%10lu %14.1f %14.1f\n", n, walk_ns, stats_ns);
+		dealloc_arena(arena);
+	}
+
+	pool_destroy_all();
+	return 0;
+}
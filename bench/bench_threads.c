@@ -0,0 +1,148 @@
+// Similea Alin-Andrei 314CA
+// Concurrent mode benchmark: threads doing READs of 4 KiB from random blocks
+// of a concurrent arena, alone("read") and mixed with WRITEs and with frees and
+// allocations of whole blocks("mixed"), for 1, 2, 4, ... threads. Every byte
+// read is checked: it must be the one its block is written with, or zero.
+// The results go to stderr.
+// Usage: bench/bench_threads [max_threads]
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <time.h>
+
+#include "mem.h"
+#include "vma.h"
+
+#define NR_BLOCKS 1024
+#define BLOCK_SIZE (64UL << 10)
+#define BLOCK_STEP (2 * BLOCK_SIZE)	 // the blocks are never adjacent
+#define ACCESS_SIZE 4096
+#define OPS_PER_THREAD 200000
+
+typedef struct {
+	arena_t *arena;
+	int mixed;
+	uint64_t seed;
+	uint64_t nr_bad;  // bytes read that were neither the pattern nor zero
+} worker_t;
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_rand(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static void fill_block(arena_t *arena, uint64_t block, int8_t *data)
+{
+	memset(data, 'a' + block % 26, BLOCK_SIZE);
+	write(arena, block * BLOCK_STEP, BLOCK_SIZE, data);
+}
+
+static void *run_worker(void *arg)
+{
+	worker_t *worker = arg;
+	arena_t *arena = worker->arena;
+	uint8_t buffer[ACCESS_SIZE], pattern[ACCESS_SIZE];
+	int8_t *data = malloc(BLOCK_SIZE);
+	DIE(!data, "malloc failed");
+
+	for (int i = 0; i < OPS_PER_THREAD; i++) {
+		uint64_t rand = next_rand(&worker->seed);
+		uint64_t block = rand % NR_BLOCKS;
+		uint64_t offset = (rand >> 20) % (BLOCK_SIZE - ACCESS_SIZE);
+		uint64_t address = block * BLOCK_STEP + offset;
+		int op = worker->mixed ? (rand >> 40) % 100 : 0;
+
+		if (op < 80) {
+			uint64_t to_read;
+			int status = read_source(arena, address, ACCESS_SIZE, &to_read);
+			if ((status & ~VMA_TRUNCATED) != VMA_OK)
+				continue;
+			copy_bytes(arena, address, to_read, buffer);
+			release_range(arena, address, to_read);
+
+			memset(pattern, 'a' + block % 26, to_read);
+			if (memcmp(buffer, pattern, to_read) == 0)
+				continue;
+			for (uint64_t j = 0; j < to_read; j++)
+				if (buffer[j] && buffer[j] != pattern[j])
+					worker->nr_bad++;
+		} else if (op < 95) {
+			memset(data, 'a' + block % 26, ACCESS_SIZE);
+			write(arena, address, ACCESS_SIZE, data);
+		} else {
+			free_block(arena, block * BLOCK_STEP);
+			alloc_block(arena, block * BLOCK_STEP, BLOCK_SIZE);
+		}
+	}
+
+	free(data);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int max_threads = argc > 1 ? atoi(argv[1]) : nr_processors();
+	const char *names[] = {"read", "mixed"};
+
+	arena_t *arena = alloc_arena(NR_BLOCKS * BLOCK_STEP);
+	make_concurrent(arena);
+
+	int8_t *data = malloc(BLOCK_SIZE);
+	DIE(!data, "malloc failed");
+	for (uint64_t i = 0; i < NR_BLOCKS; i++) {
+		alloc_block(arena, i * BLOCK_STEP, BLOCK_SIZE);
+		fill_block(arena, i, data);
+	}
+	free(data);
+
+	pthread_t *threads = malloc(max_threads * sizeof(*threads));
+	worker_t *workers = malloc(max_threads * sizeof(*workers));
+	DIE(!threads || !workers, "malloc failed");
+
+	fprintf(stderr, "%8s %8s %14s %8s\n", "workload", "threads", "ops/s",
+			"speedup");
+	for (int mixed = 0; mixed <= 1; mixed++) {
+		double base = 0;
+
+		for (int nr = 1; nr <= max_threads; nr *= 2) {
+			uint64_t nr_bad = 0;
+			double start = now_s();
+
+			for (int i = 0; i < nr; i++) {
+				workers[i].arena = arena;
+				workers[i].mixed = mixed;
+				workers[i].seed = 88172645463325252ULL + 7919 * i;
+				workers[i].nr_bad = 0;
+				DIE(pthread_create(&threads[i], NULL, run_worker, &workers[i]),
+					"pthread_create failed");
+			}
+			for (int i = 0; i < nr; i++) {
+				pthread_join(threads[i], NULL);
+				nr_bad += workers[i].nr_bad;
+			}
+
+			double ops = (double)nr * OPS_PER_THREAD / (now_s() - start);
+			if (nr == 1)
+				base = ops;
+			fprintf(stderr, "%8s %8d %14.0f %8.2f\n", names[mixed], nr, ops,
+					ops / base);
+			DIE(nr_bad, "a READ saw bytes that were never written there");
+		}
+	}
+
+	free(threads);
+	free(workers);
+	dealloc_arena(arena);
+	pool_destroy_all();
+	return 0;
+}
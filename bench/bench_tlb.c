@@ -0,0 +1,72 @@
+// Similea Alin-Andrei 314CA
+// Translation cache benchmark: the checks of 10^6 READs(of 64 bytes) on an
+// arena of 10^5 blocks, 90% of them on 32 hot blocks and the rest anywhere,
+// with caches of 0(off) to 1024 entries. Prints the time of a check and the
+// hit rate for each size. The results go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "tlb.h"
+#include "vma.h"
+
+#define NR_BLOCKS 100000
+#define BLOCK_STEP 8192	 // a block of 4 KiB every 8 KiB
+#define NR_HOT 32
+#define NR_READS 1000000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(void)
+{
+	arena_t *arena = alloc_arena((uint64_t)NR_BLOCKS * BLOCK_STEP);
+	uint64_t hot[NR_HOT], to_read;
+
+	for (uint64_t i = 0; i < NR_BLOCKS; i++)
+		alloc_block(arena, i * BLOCK_STEP, VMA_PAGE_SIZE);
+	for (int i = 0; i < NR_HOT; i++)
+		hot[i] = next_rand() % NR_BLOCKS;
+
+	fprintf(stderr, "%10s %12s %10s\n", "entries", "ns/check", "hit rate");
+	for (uint64_t entries = 0; entries <= 1024; entries = entries ? entries * 4
+																  : 4) {
+		tlb_resize(arena->tlb, entries);
+		arena->tlb->hits = 0;
+		arena->tlb->misses = 0;
+
+		uint64_t ok = 0;
+		double start = now_ns();
+		for (int i = 0; i < NR_READS; i++) {
+			uint64_t block = next_rand() % 10 ? hot[next_rand() % NR_HOT]
+											  : next_rand() % NR_BLOCKS;
+			uint64_t address = block * BLOCK_STEP + next_rand() % 4032;
+			ok += read_source(arena, address, 64, &to_read) == VMA_OK;
+			release_range(arena, address, to_read);
+		}
+		double ns = (now_ns() - start) / NR_READS;
+		DIE(ok != NR_READS, "a read failed");
+
+		uint64_t lookups = arena->tlb->hits + arena->tlb->misses;
+		fprintf(stderr, "%10lu %12.1f %9.1f%%\n", entries, ns,
+				lookups ? 100.0 * arena->tlb->hits / lookups : 0.0);
+	}
+
+	dealloc_arena(arena);
+	pool_destroy_all();
+	return 0;
+}
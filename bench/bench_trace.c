@@ -0,0 +1,341 @@
+// Similea Alin-Andrei 314CA
+// Trace benchmark: runs text commands through the same code as "./vma" and
+// reports, for each command, how many ran, the throughput and the p50, p99
+// and p999 latency, then the peak RSS of the process. The commands come from
+// the given traces(replayed as they are, "-r" times each) or, without traces,
+// from a generator of ALLOC_BLOCK, FREE_BLOCK, READ, WRITE and MPROTECT:
+//   -n ops        the number of generated commands(10^6)
+//   -m a:f:r:w:p  the weights of ALLOC_BLOCK, FREE_BLOCK, READ, WRITE and
+//                 MPROTECT(30:20:20:20:10)
+//   -s min:max    the sizes of the blocks and of the reads and writes
+//                 (16:4096)
+//   -l locality   the share of the commands on the 64 newest miniblocks(0.5)
+//   -f frag       the share of the blocks placed at random addresses, the
+//                 others go right after the last one(0.5)
+//   -a size       the size of the arena(1 GiB)
+//   -r repeat     how many times each trace is replayed(1)
+//   --radix       the arenas use the radix engine
+// The output of the commands is thrown away, the results go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <sys/resource.h>
+#include <time.h>
+
+#include "driver.h"
+#include "gaps.h"
+#include "vma.h"
+
+#define NR_TYPES 19	 // the numbers given by "command_type", 0 included
+#define NR_HOT 64
+#define MAX_LINE 128  // a generated line without the data of a WRITE
+
+static const char *const type_names[NR_TYPES] = {
+	"invalid", "ALLOC_ARENA", "DEALLOC_ARENA", "ALLOC_BLOCK", "FREE_BLOCK",
+	"READ", "WRITE", "PMAP", "MPROTECT", "ALLOC_AUTO", "STATS", "SAVE", "LOAD",
+	"MEMSET", "MEMCPY", "MEMMOVE", "MEMCMP", "READV", "WRITEV"
+};
+
+static const char *const perm_names[] = {
+	"PROT_NONE", "PROT_READ", "PROT_READ | PROT_WRITE",
+	"PROT_READ | PROT_EXEC", "PROT_READ | PROT_WRITE | PROT_EXEC"
+};
+
+// The latencies of one command.
+typedef struct {
+	uint64_t *ns;
+	uint64_t count;
+	uint64_t capacity;
+	uint64_t total_ns;
+} latencies_t;
+
+typedef struct {
+	uint64_t address;
+	uint64_t size;
+} live_t;
+
+typedef struct {
+	uint64_t nr_ops;
+	unsigned int weights[5];
+	uint64_t min_size, max_size;
+	double locality;
+	double frag;
+	uint64_t arena_size;
+	int repeat;
+} options_t;
+
+static latencies_t latencies[NR_TYPES];
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double next_unit(void)
+{
+	return (next_rand() >> 11) * (1.0 / (1ULL << 53));
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void record(int type, uint64_t ns)
+{
+	latencies_t *lat = &latencies[type];
+
+	if (lat->count == lat->capacity) {
+		lat->capacity = lat->capacity ? lat->capacity * 2 : 1024;
+		lat->ns = realloc(lat->ns, lat->capacity * sizeof(*lat->ns));
+		DIE(!lat->ns, "realloc failed");
+	}
+	lat->ns[lat->count++] = ns;
+	lat->total_ns += ns;
+}
+
+// Parses and runs a command line like the driver does, timing both. Returns 1
+// when the driver would end.
+static int run_line(arena_table_t *arenas, input_t *in, char *line,
+					size_t len)
+{
+	command_t cmd;
+	uint64_t start = now_ns();
+
+	parse_command(line, len, &cmd);
+	int end = run_command(arenas, &cmd, in, line, len, stdout);
+	record(cmd.type, now_ns() - start);
+	return end;
+}
+
+static void replay(arena_table_t *arenas, const char *path)
+{
+	FILE *file = fopen(path, "r");
+	size_t len;
+	char *line;
+	input_t in;
+
+	DIE(!file, path);
+	input_init(&in, file);
+	while ((line = input_line(&in, &len)))
+		if (line[0] != '\0' && run_line(arenas, &in, line, len))
+			break;
+	destroy_all_arenas(arenas);
+	input_destroy(&in);
+	fclose(file);
+}
+
+// Tells whether the zone is free, through the index of free zones(the
+// generator only sends ALLOC_BLOCKs that succeed).
+static int zone_is_free(arena_t *arena, uint64_t address, uint64_t size)
+{
+	if (address + size > arena->arena_size)
+		return 0;
+	avl_node_t *node = avl_floor(arena->gaps->by_address, address);
+	if (!node)
+		return 0;
+	gap_t *gap = (gap_t *)node->data;
+	return gap->start_address + gap->size >= address + size;
+}
+
+static uint64_t random_size(const options_t *opt)
+{
+	return opt->min_size + next_rand() % (opt->max_size - opt->min_size + 1);
+}
+
+// Picks a live miniblock: one of the newest ones with the given locality,
+// any of them otherwise.
+static uint64_t pick_live(uint64_t nr_live, double locality)
+{
+	if (nr_live > NR_HOT && next_unit() < locality)
+		return nr_live - 1 - next_rand() % NR_HOT;
+	return next_rand() % nr_live;
+}
+
+static int pick_command(const options_t *opt)
+{
+	unsigned int total = 0, pick;
+
+	for (int i = 0; i < 5; i++)
+		total += opt->weights[i];
+	pick = next_rand() % total;
+	for (int i = 0; i < 5; i++) {
+		if (pick < opt->weights[i])
+			return i;
+		pick -= opt->weights[i];
+	}
+	return 0;
+}
+
+static void generate(arena_table_t *arenas, const options_t *opt)
+{
+	FILE *empty = fopen("/dev/null", "r");
+	char *line = malloc(MAX_LINE + opt->max_size);
+	live_t *live = malloc(opt->nr_ops * sizeof(*live) + 1);
+	uint64_t nr_live = 0, cursor = 0;
+	input_t in;
+
+	DIE(!empty || !line || !live, "generator setup failed");
+	input_init(&in, empty);
+	int len = sprintf(line, "ALLOC_ARENA %lu", opt->arena_size);
+	run_line(arenas, &in, line, len);
+	arena_t *arena = get_arena(arenas, 0);
+
+	for (uint64_t op = 0; op < opt->nr_ops; op++) {
+		int kind = nr_live ? pick_command(opt) : 0;
+		uint64_t size = random_size(opt), address;
+
+		if (kind == 0) {  // ALLOC_BLOCK
+			address = cursor;
+			for (int tries = 0; tries < 8; tries++) {
+				if ((tries || next_unit() < opt->frag) &&
+					opt->arena_size > size)
+					address = next_rand() % (opt->arena_size - size);
+				if (zone_is_free(arena, address, size))
+					break;
+				address = opt->arena_size;
+			}
+			if (address == opt->arena_size)
+				continue;
+			len = sprintf(line, "ALLOC_BLOCK %lu %lu", address, size);
+			live[nr_live++] = (live_t){address, size};
+			cursor = address + size;
+		} else if (kind == 1) {	 // FREE_BLOCK
+			uint64_t idx = pick_live(nr_live, opt->locality);
+			len = sprintf(line, "FREE_BLOCK %lu", live[idx].address);
+			live[idx] = live[--nr_live];
+		} else {
+			live_t *minib = &live[pick_live(nr_live, opt->locality)];
+			address = minib->address + next_rand() % minib->size;
+			if (kind == 2) {
+				len = sprintf(line, "READ %lu %lu", address, size);
+			} else if (kind == 3) {
+				len = sprintf(line, "WRITE %lu %lu ", address, size);
+				for (uint64_t i = 0; i < size; i++)
+					line[len++] = 'a' + next_rand() % 26;
+			} else {
+				len = sprintf(line, "MPROTECT %lu %s", minib->address,
+							  perm_names[next_rand() % 5]);
+			}
+		}
+		run_line(arenas, &in, line, len);
+	}
+
+	destroy_all_arenas(arenas);
+	input_destroy(&in);
+	fclose(empty);
+	free(live);
+	free(line);
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const latencies_t *lat, double p)
+{
+	uint64_t idx = (uint64_t)(p * lat->count);
+
+	return lat->ns[idx < lat->count ? idx : lat->count - 1];
+}
+
+static void report(void)
+{
+	struct rusage usage;
+
+	fprintf(stderr, "%-14s %10s %12s %10s %10s %10s\n", "command", "count",
+			"ops/s", "p50 ns", "p99 ns", "p999 ns");
+	for (int type = 0; type < NR_TYPES; type++) {
+		latencies_t *lat = &latencies[type];
+		if (!lat->count)
+			continue;
+		qsort(lat->ns, lat->count, sizeof(*lat->ns), compare_ns);
+		fprintf(stderr, "%-14s %10lu %12.0f %10lu %10lu %10lu\n",
+				type_names[type], lat->count,
+				lat->count * 1e9 / (lat->total_ns ? lat->total_ns : 1),
+				percentile(lat, 0.5), percentile(lat, 0.99),
+				percentile(lat, 0.999));
+		free(lat->ns);
+	}
+	getrusage(RUSAGE_SELF, &usage);
+	fprintf(stderr, "peak RSS: %.1f MiB\n", usage.ru_maxrss / 1024.0);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-n ops] [-m a:f:r:w:p] [-s min:max] "
+			"[-l locality] [-f frag] [-a size] [-r repeat] [--radix] "
+			"[trace.in ...]\n", name);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	options_t opt = {1000000, {30, 20, 20, 20, 10}, 16, 4096, 0.5, 0.5,
+					 1ULL << 30, 1};
+	arena_table_t arenas;
+	int i, nr_traces = 0;
+
+	arenas_init(&arenas);
+	for (i = 1; i < argc; i++) {
+		const char *arg = argv[i], *val = i + 1 < argc ? argv[i + 1] : "";
+		int ok = 1;
+
+		if (strcmp(arg, "--radix") == 0) {
+			arenas.engine = VMA_ENGINE_RADIX;
+			continue;
+		}
+		if (arg[0] != '-') {
+			argv[1 + nr_traces++] = argv[i];
+			continue;
+		}
+		if (strcmp(arg, "-n") == 0)
+			opt.nr_ops = strtoull(val, NULL, 10);
+		else if (strcmp(arg, "-m") == 0)
+			ok = sscanf(val, "%u:%u:%u:%u:%u", &opt.weights[0],
+						&opt.weights[1], &opt.weights[2], &opt.weights[3],
+						&opt.weights[4]) == 5 &&
+				 opt.weights[0] + opt.weights[1] + opt.weights[2] +
+				 opt.weights[3] + opt.weights[4] > 0;
+		else if (strcmp(arg, "-s") == 0)
+			ok = sscanf(val, "%lu:%lu", &opt.min_size, &opt.max_size) == 2 &&
+				 opt.min_size && opt.min_size <= opt.max_size;
+		else if (strcmp(arg, "-l") == 0)
+			opt.locality = atof(val);
+		else if (strcmp(arg, "-f") == 0)
+			opt.frag = atof(val);
+		else if (strcmp(arg, "-a") == 0)
+			opt.arena_size = strtoull(val, NULL, 10);
+		else if (strcmp(arg, "-r") == 0)
+			opt.repeat = atoi(val);
+		else
+			ok = 0;
+		if (!ok || i + 1 == argc)
+			usage(argv[0]);
+		i++;
+	}
+
+	// The driver's output is thrown away, but still formatted and buffered.
+	DIE(!freopen("/dev/null", "w", stdout), "freopen failed");
+	setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+
+	if (nr_traces) {
+		for (int r = 0; r < opt.repeat; r++)
+			for (i = 0; i < nr_traces; i++)
+				replay(&arenas, argv[1 + i]);
+	} else {
+		generate(&arenas, &opt);
+	}
+
+	report();
+	pool_destroy_all();
+	return 0;
+}
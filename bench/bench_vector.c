@@ -0,0 +1,139 @@
+// Similea Alin-Andrei 314CA
+// Vectored benchmark: 16 to 256 fields of 16 bytes, spread over an arena of
+// 10^4 blocks(written once before, so no page is touched for the first time),
+// read and written through the text driver with one READ or WRITE for each
+// field, and with a single READV or WRITEV for all of them. Prints the time per
+// field, parsing and output included(the output is thrown away). The results
+// go to stderr.
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+
+#include "driver.h"
+#include "vma.h"
+
+#define NR_BLOCKS 10000
+#define BLOCK_STEP 8192	 // a block of 4 KiB every 8 KiB
+#define FIELD_SIZE 16
+#define FIELD_DATA "abcdefghijklmnop"
+#define MAX_FIELDS 256
+#define LINE_SIZE 64  // the room of a READ or WRITE line in a round
+#define NR_ROUNDS 2000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_rand(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void run_line(arena_table_t *arenas, input_t *in, char *line, int len)
+{
+	command_t cmd;
+
+	parse_command(line, len, &cmd);
+	run_command(arenas, &cmd, in, line, len, stdout);
+}
+
+// Builds the commands of a round, each one at "buf + i * LINE_SIZE": one for
+// each field, or a single one for all of them. Returns their number.
+static int build_round(char *buf, int *lens, const uint64_t *fields,
+					   int nr_fields, int writing, int vectored)
+{
+	if (!vectored) {
+		for (int i = 0; i < nr_fields; i++)
+			lens[i] = sprintf(buf + i * LINE_SIZE,
+							  writing ? "WRITE %lu %d " FIELD_DATA
+									  : "READ %lu %d",
+							  fields[i], FIELD_SIZE);
+		return nr_fields;
+	}
+
+	int len = sprintf(buf, "%s %d", writing ? "WRITEV" : "READV", nr_fields);
+	for (int i = 0; i < nr_fields; i++)
+		len += sprintf(buf + len, " %lu %d", fields[i], FIELD_SIZE);
+	if (writing) {
+		buf[len++] = ' ';
+		for (int i = 0; i < nr_fields; i++, len += FIELD_SIZE)
+			memcpy(buf + len, FIELD_DATA, FIELD_SIZE);
+	}
+	lens[0] = len;
+	return 1;
+}
+
+static double bench_round(arena_table_t *arenas, input_t *in, int nr_fields,
+						  int writing, int vectored)
+{
+	static char buf[MAX_FIELDS * LINE_SIZE];
+	static char line[MAX_FIELDS * LINE_SIZE];
+	uint64_t fields[MAX_FIELDS];
+	int lens[MAX_FIELDS];
+	double total = 0;
+
+	for (int round = 0; round < NR_ROUNDS; round++) {
+		for (int i = 0; i < nr_fields; i++)
+			fields[i] = next_rand() % NR_BLOCKS * BLOCK_STEP +
+						next_rand() % (4096 - FIELD_SIZE);
+		int nr_lines = build_round(buf, lens, fields, nr_fields, writing,
+								   vectored);
+
+		double start = now_ns();
+		for (int i = 0; i < nr_lines; i++) {
+			// The driver parses a line in place, so it gets a copy.
+			memcpy(line, buf + i * LINE_SIZE, lens[i]);
+			run_line(arenas, in, line, lens[i]);
+		}
+		total += now_ns() - start;
+	}
+	return total / NR_ROUNDS / nr_fields;
+}
+
+int main(void)
+{
+	FILE *empty = fopen("/dev/null", "r");
+	arena_table_t arenas;
+	input_t in;
+	char line[64];
+
+	DIE(!empty, "fopen failed");
+	input_init(&in, empty);
+	arenas_init(&arenas);
+	DIE(!freopen("/dev/null", "w", stdout), "freopen failed");
+	setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+
+	int len = sprintf(line, "ALLOC_ARENA %lu", (uint64_t)NR_BLOCKS * BLOCK_STEP);
+	run_line(&arenas, &in, line, len);
+	for (uint64_t i = 0; i < NR_BLOCKS; i++) {
+		len = sprintf(line, "ALLOC_BLOCK %lu 4096", i * BLOCK_STEP);
+		run_line(&arenas, &in, line, len);
+		len = sprintf(line, "MEMSET %lu 4096 97", i * BLOCK_STEP);
+		run_line(&arenas, &in, line, len);
+	}
+
+	fprintf(stderr, "%8s %12s %12s %12s %12s\n", "fields", "WRITE ns",
+			"WRITEV ns", "READ ns", "READV ns");
+	for (int nr_fields = 16; nr_fields <= MAX_FIELDS; nr_fields *= 4) {
+		double write_ns = bench_round(&arenas, &in, nr_fields, 1, 0);
+		double writev_ns = bench_round(&arenas, &in, nr_fields, 1, 1);
+		double read_ns = bench_round(&arenas, &in, nr_fields, 0, 0);
+		double readv_ns = bench_round(&arenas, &in, nr_fields, 0, 1);
+		fprintf(stderr, "%8d %12.1f %12.1f %12.1f %12.1f\n", nr_fields,
+				write_ns, writev_ns, read_ns, readv_ns);
+	}
+
+	destroy_all_arenas(&arenas);
+	input_destroy(&in);
+	fclose(empty);
+	pool_destroy_all();
+	return 0;
+}
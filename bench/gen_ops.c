@@ -0,0 +1,71 @@
+// Similea Alin-Andrei 314CA
+// Generator for the protocol benchmark: prints the same stream of operations
+// (ALLOC_BLOCK, WRITE, READ and FREE_BLOCK of small blocks, between an
+// ALLOC_ARENA and a DEALLOC_ARENA) as text commands or as binary requests.
+// Usage: bench/gen_ops [--binary] nr_operations
+#include "binary.h"
+#include "vma.h"
+
+#define ARENA_SIZE (1UL << 30)
+#define BLOCK_SIZE 64
+#define NR_SLOTS 65536	// blocks alive at once, at most
+
+static void put_request(uint8_t opcode, uint64_t address, uint64_t size)
+{
+	bin_request_t req = {0};
+
+	req.opcode = opcode;
+	req.address = address;
+	req.size = size;
+	fwrite(&req, sizeof(req), 1, stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	int binary = argc == 3 && strcmp(argv[1], "--binary") == 0;
+	char data[BLOCK_SIZE];
+
+	if (argc != 2 + binary) {
+		fprintf(stderr, "Usage: %s [--binary] nr_operations\n", argv[0]);
+		return 1;
+	}
+	uint64_t nr_ops = strtoull(argv[argc - 1], NULL, 10);
+
+	setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+	for (int i = 0; i < BLOCK_SIZE; i++)
+		data[i] = 'a' + i % 26;
+
+	if (binary)
+		put_request(1, 0, ARENA_SIZE);
+	else
+		printf("ALLOC_ARENA %lu\n", ARENA_SIZE);
+
+	// Every slot gets its block allocated, written, read and freed in turn.
+	for (uint64_t i = 0; i < nr_ops; i++) {
+		uint64_t address = (i / 4 % NR_SLOTS) * 2 * BLOCK_SIZE;
+		int op = i % 4;
+
+		if (binary) {
+			put_request(op == 0 ? 3 : op == 1 ? 6 : op == 2 ? 5 : 4, address,
+						BLOCK_SIZE);
+			if (op == 1)
+				fwrite(data, 1, BLOCK_SIZE, stdout);
+			continue;
+		}
+		if (op == 0)
+			printf("ALLOC_BLOCK %lu %d\n", address, BLOCK_SIZE);
+		else if (op == 1)
+			printf("WRITE %lu %d %.*s\n", address, BLOCK_SIZE, BLOCK_SIZE,
+				   data);
+		else if (op == 2)
+			printf("READ %lu %d\n", address, BLOCK_SIZE);
+		else
+			printf("FREE_BLOCK %lu\n", address);
+	}
+
+	if (binary)
+		put_request(2, 0, 0);
+	else
+		printf("DEALLOC_ARENA\n");
+	return 0;
+}
@@ -0,0 +1,49 @@
+// Similea Alin-Andrei 314CA
+// Counts the calls to the system allocator made by the program it is linked
+// in (link with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free).
+// The totals are printed on stderr when the program exits.
+#include <stdio.h>
+#include <stdlib.h>
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static unsigned long nr_allocs, nr_frees;
+
+static void print_counts(void)
+{
+	fprintf(stderr, "allocs %lu frees %lu\n", nr_allocs, nr_frees);
+}
+
+static void count_alloc(void)
+{
+	if (nr_allocs++ == 0)
+		atexit(print_counts);
+}
+
+void *__wrap_malloc(size_t size)
+{
+	count_alloc();
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	count_alloc();
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	count_alloc();
+	return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+	if (ptr)
+		nr_frees++;
+	__real_free(ptr);
+}
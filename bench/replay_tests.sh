@@ -0,0 +1,32 @@
+#!/bin/bash
+# Replays every tasks/vma/tests input through bench/vma_count and prints, for
+# each one, the time it took and the calls made to the system allocator.
+# Usage: bench/replay_tests.sh [repetitions]
+
+cd "$(dirname "$0")/.." || exit 1
+REPS=${1:-1}
+BIN=bench/vma_count
+
+total_cmds=0
+total_allocs=0
+total_time=0
+printf "%-10s %10s %12s %12s %10s\n" test commands allocs frees ms
+for input in tasks/vma/tests/*/*.in; do
+	cmds=$(wc -l < "$input")
+	start=$(date +%s%N)
+	for ((i = 0; i < REPS; i++)); do
+		counts=$($BIN < "$input" 2>&1 >/dev/null | tail -n 1)
+	done
+	end=$(date +%s%N)
+	allocs=$(echo "$counts" | awk '{print $2}')
+	frees=$(echo "$counts" | awk '{print $4}')
+	ms=$(((end - start) / 1000000 / REPS))
+	printf "%-10s %10d %12d %12d %10d\n" "$(basename "$input" .in)" \
+		"$cmds" "$allocs" "$frees" "$ms"
+	total_cmds=$((total_cmds + cmds))
+	total_allocs=$((total_allocs + allocs))
+	total_time=$((total_time + end - start))
+done
+total_ms=$((total_time / 1000000 / REPS))
+printf "%-10s %10d %12d %12s %10d\n" total "$total_cmds" "$total_allocs" \
+	"" "$total_ms"
@@ -0,0 +1,376 @@
+// Similea Alin-Andrei 314CA
+#include "binary.h"
+
+#include "bulk.h"
+#include "checkpoint.h"
+#include "metrics.h"
+#include "snapshot.h"
+#include "vector.h"
+#include "vma.h"
+
+static void send_reply(FILE *out, uint8_t opcode, int status, uint64_t length)
+{
+	bin_reply_t reply = {0};
+
+	metrics_status(status);
+	reply.opcode = opcode;
+	reply.status = status;
+	reply.length = length;
+	fwrite(&reply, sizeof(reply), 1, out);
+}
+
+static void send_pmap(arena_t *arena, FILE *out)
+{
+	bin_pmap_t summary;
+
+	if (!arena) {
+		send_reply(out, 7, VMA_NO_ARENA, 0);
+		return;
+	}
+
+	snapshot_t *snap = take_snapshot(arena);
+	summary.total_memory = snap->arena_size;
+	summary.free_memory = snap->free_memory;
+	summary.reserved_memory = (snap->arena_size + VMA_PAGE_SIZE - 1) /
+							  VMA_PAGE_SIZE * VMA_PAGE_SIZE;
+	summary.resident_memory = __atomic_load_n(&arena->nr_written_pages,
+											  __ATOMIC_RELAXED) *
+							  VMA_PAGE_SIZE;
+	summary.nr_blocks = snap->nr_blocks;
+	summary.nr_miniblocks = snap->nr_miniblocks;
+	drop_snapshot(snap);
+
+	send_reply(out, 7, VMA_OK, sizeof(summary));
+	fwrite(&summary, sizeof(summary), 1, out);
+}
+
+// Reads the file name following a SAVE or a LOAD. Returns 0 if it is too long
+// (it is still consumed).
+static int read_path(input_t *in, uint64_t size, char *path)
+{
+	if (size >= CKPT_MAX_PATH) {
+		input_read(in, NULL, size);
+		return 0;
+	}
+	input_read(in, path, size);
+	path[size] = '\0';
+	return 1;
+}
+
+// Reads the zones following a READV or a WRITEV. Returns NULL if there are
+// none or too many(they are still consumed, the data of a WRITEV too).
+static segment_t *read_segment_list(input_t *in, uint64_t nr_segs,
+									int writing)
+{
+	segment_t *segs;
+	bin_segment_t seg;
+	uint64_t total = 0;
+
+	if (nr_segs && nr_segs <= VMA_MAX_SEGMENTS) {
+		segs = malloc(nr_segs * sizeof(*segs));
+		DIE(!segs, "malloc failed");
+		for (uint64_t i = 0; i < nr_segs; i++) {
+			input_read(in, &seg, sizeof(seg));
+			segs[i].address = seg.address;
+			segs[i].size = seg.size;
+		}
+		return segs;
+	}
+
+	for (uint64_t i = 0; i < nr_segs; i++) {
+		if (input_read(in, &seg, sizeof(seg)) != sizeof(seg))
+			return NULL;
+		total += seg.size;
+	}
+	if (writing)
+		input_read(in, NULL, total);
+	return NULL;
+}
+
+// Sends the bytes of all the zones of a READV: first the length of each zone,
+// then their bytes, one after another.
+static void send_vector(arena_t *arena, segment_t *segs, uint64_t nr_segs,
+						FILE *out)
+{
+	int status = read_segments(arena, segs, nr_segs);
+	uint64_t total = 0;
+
+	if (status != VMA_OK && status != VMA_TRUNCATED) {
+		send_reply(out, 17, status, 0);
+		return;
+	}
+	for (uint64_t i = 0; i < nr_segs; i++)
+		total += segs[i].length;
+	send_reply(out, 17, status, nr_segs * sizeof(uint64_t) + total);
+	for (uint64_t i = 0; i < nr_segs; i++)
+		fwrite(&segs[i].length, sizeof(uint64_t), 1, out);
+	for (uint64_t i = 0; i < nr_segs; i++)
+		output_zone(arena, segs[i].address, segs[i].length, out);
+	release_segments(arena, segs, nr_segs);
+}
+
+// Writes the data following a WRITEV to its zones(it is only consumed if they
+// can't be written). "length" gets the bytes written.
+static int receive_vector(input_t *in, arena_t *arena, segment_t *segs,
+						  uint64_t nr_segs, uint64_t *length)
+{
+	int status = write_segments(arena, segs, nr_segs);
+	int ok = status == VMA_OK || status == VMA_TRUNCATED;
+
+	*length = 0;
+	for (uint64_t i = 0; i < nr_segs; i++) {
+		uint64_t kept = ok ? segs[i].length : 0;
+		input_read(in, kept ? arena->base + segs[i].address : NULL, kept);
+		input_read(in, NULL, segs[i].size - kept);
+		*length += kept;
+	}
+	if (ok)
+		release_segments(arena, segs, nr_segs);
+	return status;
+}
+
+// Sends the bytes of a READ.
+static void send_read(arena_t *arena, bin_request_t *req, FILE *out)
+{
+	uint64_t length;
+	int status = read_source(arena, req->address, req->size, &length);
+
+	if ((status & ~VMA_TRUNCATED) != VMA_OK) {
+		send_reply(out, 5, status, 0);
+		return;
+	}
+	send_reply(out, 5, status, length);
+	output_zone(arena, req->address, length, out);
+	release_range(arena, req->address, length);
+}
+
+// Writes the data following a WRITE(it is only consumed past the block or if
+// it can't be written).
+static void receive_write(input_t *in, arena_t *arena, bin_request_t *req,
+						  FILE *out)
+{
+	uint8_t *dest;
+	uint64_t length;
+	int status = write_destination(arena, req->address, req->size, &dest,
+								   &length);
+
+	if (!dest)
+		length = 0;
+	input_read(in, dest, length);
+	input_read(in, NULL, req->size - length);
+	if (dest)
+		release_range(arena, req->address, length);
+	send_reply(out, 6, status, length);
+}
+
+// MPROTECT changes a single miniblock if it has no size, else a range. The
+// permissions can only be the 3 bits the text commands give.
+static int change_perms(arena_t *arena, bin_request_t *req)
+{
+	if (req->perm > 7)
+		return VMA_INVALID_MPROTECT;
+	if (req->size)
+		return mprotect_range(arena, req->address, req->size, req->perm);
+	return mprotect(arena, req->address, req->perm);
+}
+
+// Sends the address picked by ALLOC_AUTO.
+static void send_auto(arena_t *arena, bin_request_t *req, FILE *out)
+{
+	uint64_t address;
+	int status = alloc_auto(arena, req->size, req->address ? req->address : 1,
+							req->perm, &address);
+
+	send_reply(out, 9, status, status == VMA_OK ? address : 0);
+}
+
+static void send_stats(arena_t *arena, FILE *out)
+{
+	arena_stats_t stats;
+	int status = arena_stats(arena, &stats);
+
+	if (status != VMA_OK) {
+		send_reply(out, 10, status, 0);
+		return;
+	}
+	send_reply(out, 10, status, sizeof(stats));
+	fwrite(&stats, sizeof(stats), 1, out);
+}
+
+// Runs a SAVE or a LOAD with the file name following it.
+static int run_checkpoint(input_t *in, arena_table_t *arenas, arena_t *arena,
+						  bin_request_t *req)
+{
+	char path[CKPT_MAX_PATH];
+
+	if (!read_path(in, req->size, path))
+		return VMA_INVALID_COMMAND;
+	if (req->opcode == 11)
+		return save_checkpoint(arena, path);
+	return load_arena(arenas, req->arena, path);
+}
+
+static void send_set(arena_t *arena, bin_request_t *req, FILE *out)
+{
+	uint64_t length;
+	int status = bulk_set(arena, req->address, req->size, req->perm, &length);
+
+	send_reply(out, 13, status, length);
+}
+
+// Runs a MEMCPY or a MEMMOVE with the source address following it.
+static void send_copy(input_t *in, arena_t *arena, bin_request_t *req,
+					  FILE *out)
+{
+	uint64_t source, length;
+	int status;
+
+	input_read(in, &source, sizeof(source));
+	status = bulk_copy(arena, req->address, source, req->size,
+					   req->opcode == 15, &length);
+	send_reply(out, req->opcode, status, length);
+}
+
+static void send_compare(input_t *in, arena_t *arena, bin_request_t *req,
+						 FILE *out)
+{
+	bin_compare_t compare;
+	uint64_t source;
+	int status, result;
+
+	input_read(in, &source, sizeof(source));
+	status = bulk_compare(arena, req->address, source, req->size, &result,
+						  &compare.compared);
+	compare.result = result;
+	if ((status & ~VMA_TRUNCATED) != VMA_OK) {
+		send_reply(out, 16, status, 0);
+		return;
+	}
+	send_reply(out, 16, status, sizeof(compare));
+	fwrite(&compare, sizeof(compare), 1, out);
+}
+
+// Runs a READV or a WRITEV with the zones following it.
+static void run_vector(input_t *in, arena_t *arena, bin_request_t *req,
+					   FILE *out)
+{
+	segment_t *segs = read_segment_list(in, req->size, req->opcode == 18);
+	uint64_t length;
+	int status;
+
+	if (!segs) {
+		send_reply(out, req->opcode, VMA_INVALID_COMMAND, 0);
+		return;
+	}
+	if (req->opcode == 17) {
+		send_vector(arena, segs, req->size, out);
+	} else {
+		status = receive_vector(in, arena, segs, req->size, &length);
+		send_reply(out, req->opcode, status, length);
+	}
+	free(segs);
+}
+
+// Runs a request. The ones without a reply of their own only send their
+// status.
+static void run_request(input_t *in, arena_table_t *arenas,
+						bin_request_t *req, FILE *out)
+{
+	arena_t *arena = get_arena(arenas, req->arena);
+	int status;
+
+	switch (req->opcode) {
+		case 1:	 // ALLOC_ARENA
+			status = create_arena(arenas, req->arena, req->size,
+								  req->perm ? req->perm - 1 : arenas->engine);
+			break;
+
+		case 2:	 // DEALLOC_ARENA
+			dump_metrics();
+			status = destroy_arena(arenas, req->arena);
+			break;
+
+		case 3:	 // ALLOC_BLOCK
+			status = alloc_block(arena, req->address, req->size);
+			break;
+
+		case 4:	 // FREE_BLOCK
+			status = free_block(arena, req->address);
+			break;
+
+		case 5:	 // READ
+			send_read(arena, req, out);
+			return;
+
+		case 6:	 // WRITE
+			receive_write(in, arena, req, out);
+			return;
+
+		case 7:	 // PMAP
+			send_pmap(arena, out);
+			return;
+
+		case 8:	 // MPROTECT
+			status = change_perms(arena, req);
+			break;
+
+		case 9:	 // ALLOC_AUTO
+			send_auto(arena, req, out);
+			return;
+
+		case 10:  // STATS
+			send_stats(arena, out);
+			return;
+
+		case 11:  // SAVE
+		case 12:  // LOAD
+			status = run_checkpoint(in, arenas, arena, req);
+			break;
+
+		case 13:  // MEMSET
+			send_set(arena, req, out);
+			return;
+
+		case 14:  // MEMCPY
+		case 15:  // MEMMOVE
+			send_copy(in, arena, req, out);
+			return;
+
+		case 16:  // MEMCMP
+			send_compare(in, arena, req, out);
+			return;
+
+		case 17:  // READV
+		case 18:  // WRITEV
+			run_vector(in, arena, req, out);
+			return;
+
+		default:
+			status = VMA_INVALID_COMMAND;
+			break;
+	}
+	send_reply(out, req->opcode, status, 0);
+}
+
+// Runs the requests from "in" until the end of the input, with the same
+// operations as the text commands. DEALLOC_ARENA only deallocates the arena of
+// its handle, the remaining ones are deallocated at the end. The replies are
+// flushed whenever no more requests are waiting in the input buffer, so a
+// client can wait for them before sending more.
+void run_binary(input_t *in, arena_table_t *arenas, FILE *out)
+{
+	bin_request_t req;
+
+	while (1) {
+		if (in->pos == in->end)
+			fflush(out);
+		if (input_read(in, &req, sizeof(req)) != sizeof(req))
+			break;
+		metrics_begin(req.opcode);
+		run_request(in, arenas, &req, out);
+		metrics_end();
+	}
+
+	destroy_all_arenas(arenas);
+	fflush(out);
+}
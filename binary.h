@@ -0,0 +1,84 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "input.h"
+#include "vma.h"
+
+// The binary protocol("./vma --binary"): every request is a fixed-size record,
+// the one of a WRITE being followed by its data. Every request gets a
+// fixed-size reply, followed by the bytes of a READ or the summary of a PMAP.
+// The numbers are in the byte order of the machine.
+
+// A request. The opcodes are the numbers given by "command_type"
+// (1 ALLOC_ARENA, 2 DEALLOC_ARENA, 3 ALLOC_BLOCK, 4 FREE_BLOCK, 5 READ,
+// 6 WRITE, 7 PMAP, 8 MPROTECT, 9 ALLOC_AUTO, 10 STATS, 11 SAVE, 12 LOAD,
+// 13 MEMSET, 14 MEMCPY, 15 MEMMOVE, 16 MEMCMP, 17 READV, 18 WRITEV). The
+// request of a MEMCPY, a MEMMOVE or a MEMCMP is followed by the second
+// address(the source), 8 bytes. The request of a READV or a WRITEV is followed
+// by its zones("bin_segment_t", "size" of them) and, for a WRITEV, by the data
+// of all the zones, one after another.
+typedef struct {
+	uint8_t opcode;
+	uint8_t perm;  // MPROTECT: 4 read, 2 write, 1 execute;
+				   // MEMSET: the byte;
+				   // ALLOC_AUTO: the policy(VMA_FIRST_FIT, ...);
+				   // ALLOC_ARENA: 1 + the engine(VMA_ENGINE_TREE, ...),
+				   // or 0 for the one given to the driver
+	uint8_t unused[2];
+	uint32_t arena;	 // the handle of the arena
+	uint64_t address;  // ALLOC_AUTO: the alignment(0 for none);
+					   // MEMCPY, MEMMOVE: the destination
+	uint64_t size;	// ALLOC_ARENA: the size of the arena; WRITE: the bytes
+					// of data following the request; MPROTECT: the bytes
+					// of the zone(0 for the miniblock at the address);
+					// SAVE, LOAD: the bytes of the file name following
+					// the request(no terminator); READV, WRITEV: the
+					// number of zones
+} bin_request_t;
+
+// A zone of a READV or a WRITEV.
+typedef struct {
+	uint64_t address;
+	uint64_t size;
+} bin_segment_t;
+
+// A reply. "status" is one of the VMA_* results, with VMA_TRUNCATED added if
+// the zone of a READ, a WRITE or a bulk operation was cut to the end of its
+// block.
+typedef struct {
+	uint8_t opcode;
+	uint8_t status;
+	uint8_t unused[6];
+	uint64_t length;  // READ, PMAP, STATS, MEMCMP, READV: the bytes
+					  // following the reply;
+					  // WRITE, MEMSET, MEMCPY, MEMMOVE, WRITEV: the bytes
+					  // written;
+					  // ALLOC_AUTO: the address of the block
+} bin_reply_t;
+
+// The bytes following the reply of a PMAP.
+typedef struct {
+	uint64_t total_memory;
+	uint64_t free_memory;
+	uint64_t reserved_memory;
+	uint64_t resident_memory;
+	uint64_t nr_blocks;
+	uint64_t nr_miniblocks;
+} bin_pmap_t;
+
+// The reply of a READV is followed by the length of each zone(8 bytes, the
+// bytes of the zone that are in its block) and then by the bytes of all the
+// zones.
+
+// The bytes following the reply of a MEMCMP.
+typedef struct {
+	uint64_t compared;	// the bytes compared
+	int64_t result;	 // -1, 0 or 1, like memcmp(3)
+} bin_compare_t;
+
+// The bytes following the reply of a STATS are an "arena_stats_t"("vma.h").
+
+// ===== Binary protocol functions =====
+void run_binary(input_t *in, arena_table_t *arenas, FILE *out);
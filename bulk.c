@@ -0,0 +1,231 @@
+// Similea Alin-Andrei 314CA
+#include "bulk.h"
+
+#include "locks.h"
+#include "metrics.h"
+#include "perms.h"
+
+static int failed(int status)
+{
+	return (status & ~VMA_TRUNCATED) != VMA_OK;
+}
+
+// Verifies if a zone starts in a block and cuts its length("len") to the end
+// of that block. mode = 4 -> the zone is read; mode = 2 -> it is written
+static int check_zone(arena_t *arena, uint64_t address, int mode,
+					  uint64_t *len)
+{
+	block_t *block = find_block(arena, address, NULL);
+
+	if (!block)
+		return mode == 4 ? VMA_INVALID_READ : VMA_INVALID_WRITE;
+	if (block->start_address + block->size - address < *len) {
+		*len = block->start_address + block->size - address;
+		return VMA_TRUNCATED;
+	}
+	return VMA_OK;
+}
+
+static int check_zone_perm(arena_t *arena, uint64_t address, int mode,
+						   uint64_t len)
+{
+	if (perms_check(arena, address, len, mode))
+		return VMA_OK;
+	return mode == 4 ? VMA_PERM_READ : VMA_PERM_WRITE;
+}
+
+// Checks the zones of an operation: "first" needs the permission "first_mode"
+// and "second" the permission "second_mode"(0 if there is no second zone).
+// "len" gets the bytes both zones have in their blocks. If the operation can
+// go on, both zones stay locked until "unlock_ranges" is called for them.
+static int start_zones(arena_t *arena, uint64_t first, int first_mode,
+					   uint64_t second, int second_mode, uint64_t size,
+					   uint64_t *len)
+{
+	*len = size;
+	lock_tree(arena->locks, 0);
+	int status = check_zone(arena, first, first_mode, len);
+	if (!failed(status) && second_mode)
+		status |= check_zone(arena, second, second_mode, len);
+	if (failed(status)) {
+		// The address is wrong, the length means nothing.
+		unlock_tree(arena->locks);
+		*len = 0;
+		return status & ~VMA_TRUNCATED;
+	}
+
+	status |= check_zone_perm(arena, first, first_mode, *len);
+	if (!failed(status) && second_mode)
+		status |= check_zone_perm(arena, second, second_mode, *len);
+	if (!failed(status))
+		lock_ranges(arena->locks, first, second_mode ? second : first, *len,
+					first_mode == 2 || second_mode == 2);
+	unlock_tree(arena->locks);
+	return status;
+}
+
+// The length of the next piece of two zones walked forwards from "a" and "b":
+// a piece never crosses the end of a page in either of them.
+static uint64_t piece_after(uint64_t a, uint64_t b, uint64_t left)
+{
+	uint64_t piece = VMA_PAGE_SIZE - a % VMA_PAGE_SIZE;
+
+	if (VMA_PAGE_SIZE - b % VMA_PAGE_SIZE < piece)
+		piece = VMA_PAGE_SIZE - b % VMA_PAGE_SIZE;
+	return piece < left ? piece : left;
+}
+
+// Same, for two zones walked backwards from their ends "a" and "b".
+static uint64_t piece_before(uint64_t a, uint64_t b, uint64_t left)
+{
+	uint64_t piece = (a - 1) % VMA_PAGE_SIZE + 1;
+
+	if ((b - 1) % VMA_PAGE_SIZE + 1 < piece)
+		piece = (b - 1) % VMA_PAGE_SIZE + 1;
+	return piece < left ? piece : left;
+}
+
+// Copies which bytes of a piece were written along with them. A piece is
+// usually written whole or not at all, only a mixed one is copied bit by bit
+// (through "flags", so the zones may overlap).
+static void copy_written(arena_t *arena, uint64_t dest, uint64_t src,
+						 uint64_t len)
+{
+	uint8_t flags[VMA_PAGE_SIZE];
+
+	if (written_run(arena, src, src + len, 1) == src + len) {
+		set_written(arena, dest, len, 1);
+	} else if (written_run(arena, src, src + len, 0) == src + len) {
+		set_written(arena, dest, len, 0);
+	} else {
+		for (uint64_t i = 0; i < len; i++)
+			flags[i] = byte_written(arena, src + i);
+		for (uint64_t i = 0; i < len; i++)
+			set_written(arena, dest + i, 1, flags[i]);
+	}
+}
+
+// Copies a piece that is on a single page of the source and of the
+// destination. Copying from a page never written means copying zeroes, which
+// only changes a destination page that was written.
+static void copy_piece(arena_t *arena, uint64_t dest, uint64_t src,
+					   uint64_t len)
+{
+	int dest_written = page_written(arena, dest / VMA_PAGE_SIZE);
+
+	copy_written(arena, dest, src, len);
+	if (!page_written(arena, src / VMA_PAGE_SIZE)) {
+		if (dest_written)
+			memset(arena->base + dest, 0, len);
+		return;
+	}
+	if (!dest_written)
+		mark_pages_written(arena, dest, len);
+	memmove(arena->base + dest, arena->base + src, len);
+}
+
+// Sets "size" bytes from the address to "byte". "done" gets how many of them
+// were in the block. Setting them to zero gives the whole pages back to the
+// system, like freeing them does, but the bytes still count as written.
+int bulk_set(arena_t *arena, uint64_t address, uint64_t size, uint8_t byte,
+			 uint64_t *done)
+{
+	*done = 0;
+	if (!arena)
+		return VMA_INVALID_WRITE;
+
+	int status = start_zones(arena, address, 2, 0, 0, size, done);
+	if (failed(status))
+		return status;
+
+	if (byte) {
+		mark_written(arena, address, *done);
+		memset(arena->base + address, byte, *done);
+	} else {
+		clear_memory(arena, address, *done);
+		set_written(arena, address, *done, 1);
+	}
+	METRICS_ADD(metrics.bytes_written, *done);
+	unlock_ranges(arena->locks, address, address, *done);
+	return status;
+}
+
+// Copies "size" bytes from "src" to "dest". The zones may only overlap if
+// "overlap" is set(MEMMOVE): then the copy goes backwards when the
+// destination is after the source, so every byte is read before it is
+// overwritten. "done" gets how many bytes were copied.
+int bulk_copy(arena_t *arena, uint64_t dest, uint64_t src, uint64_t size,
+			  int overlap, uint64_t *done)
+{
+	*done = 0;
+	if (!arena)
+		return VMA_INVALID_READ;
+
+	uint64_t len;
+	int status = start_zones(arena, src, 4, dest, 2, size, &len);
+	if (failed(status)) {
+		*done = len;
+		return status;
+	}
+
+	int overlapping = dest < src + len && src < dest + len;
+	if (overlapping && !overlap) {
+		unlock_ranges(arena->locks, src, dest, len);
+		return VMA_OVERLAP;
+	}
+
+	uint64_t left = len, piece;
+	if (overlapping && dest > src) {
+		for (; left; left -= piece) {
+			piece = piece_before(dest + left, src + left, left);
+			copy_piece(arena, dest + left - piece, src + left - piece, piece);
+		}
+	} else {
+		for (uint64_t pos = 0; left; left -= piece, pos += piece) {
+			piece = piece_after(dest + pos, src + pos, left);
+			copy_piece(arena, dest + pos, src + pos, piece);
+		}
+	}
+
+	METRICS_ADD(metrics.bytes_read, len);
+	METRICS_ADD(metrics.bytes_written, len);
+	unlock_ranges(arena->locks, src, dest, len);
+	*done = len;
+	return status;
+}
+
+// Compares "size" bytes from "first" with the ones from "second", like
+// memcmp(3): "result" gets -1, 0 or 1. "done" gets how many bytes were
+// compared(at most the ones of the shortest zone). The pages never written are
+// read from the zero page, so two of them at the same offset are skipped.
+int bulk_compare(arena_t *arena, uint64_t first, uint64_t second,
+				 uint64_t size, int *result, uint64_t *done)
+{
+	*result = 0;
+	*done = 0;
+	if (!arena)
+		return VMA_INVALID_READ;
+
+	uint64_t len;
+	int status = start_zones(arena, first, 4, second, 4, size, &len);
+	if (failed(status)) {
+		*done = len;
+		return status;
+	}
+
+	uint64_t left = len, piece;
+	for (uint64_t pos = 0; left && !*result; left -= piece, pos += piece) {
+		piece = piece_after(first + pos, second + pos, left);
+		const uint8_t *a = page_data(arena, (first + pos) / VMA_PAGE_SIZE) +
+						   (first + pos) % VMA_PAGE_SIZE;
+		const uint8_t *b = page_data(arena, (second + pos) / VMA_PAGE_SIZE) +
+						   (second + pos) % VMA_PAGE_SIZE;
+		int diff = a == b ? 0 : memcmp(a, b, piece);
+		*result = (diff > 0) - (diff < 0);
+	}
+
+	METRICS_ADD(metrics.bytes_read, 2 * len);
+	unlock_ranges(arena->locks, first, second, len);
+	*done = len;
+	return status;
+}
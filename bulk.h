@@ -0,0 +1,24 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+#include "vma.h"
+
+// Bulk operations inside an arena(MEMSET, MEMCPY, MEMMOVE, MEMCMP), so big
+// zones never have to go through a READ and a WRITE. Each zone must start in a
+// block and is cut to its end like the zone of a READ or a WRITE(the result
+// gets VMA_TRUNCATED); the two zones of a copy or a comparison may be in
+// different blocks and they keep the same length. The permissions are checked
+// like for a READ(the zones read) and a WRITE(the zones written), on every
+// miniblock crossed.
+// The bytes are handled page by page with the string functions of the C
+// library, which already use the widest registers of the machine, and the
+// pages never written are never touched: they are known to hold zeroes.
+
+// ===== Bulk memory functions =====
+int bulk_set(arena_t *arena, uint64_t address, uint64_t size, uint8_t byte,
+			 uint64_t *done);
+int bulk_copy(arena_t *arena, uint64_t dest, uint64_t src, uint64_t size,
+			  int overlap, uint64_t *done);
+int bulk_compare(arena_t *arena, uint64_t first, uint64_t second,
+				 uint64_t size, int *result, uint64_t *done);
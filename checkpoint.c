@@ -0,0 +1,402 @@
+// Similea Alin-Andrei 314CA
+#include "checkpoint.h"
+
+#include "gaps.h"
+#include "list.h"
+#include "mem.h"
+#include "perms.h"
+#include "radix.h"
+#include "vma.h"
+
+static uint64_t nr_pages_of(uint64_t arena_size)
+{
+	return (arena_size + VMA_PAGE_SIZE - 1) / VMA_PAGE_SIZE;
+}
+
+static int is_written(const uint8_t *bitmap, uint64_t page)
+{
+	return (bitmap[page / 8] >> (page % 8)) & 1;
+}
+
+static uint64_t header_checksum(const ckpt_header_t *header)
+{
+	const uint8_t *bytes = (const uint8_t *)header;
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < offsetof(ckpt_header_t, checksum); i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	return hash;
+}
+
+// Finds the next run of written pages, from "*page" on. The bytes of the
+// bitmap with no written page(or only written pages) are skipped at once.
+// Returns 0 if there is none.
+static int next_run(const arena_t *arena, uint64_t *page, uint64_t *nr_pages)
+{
+	const uint8_t *bitmap = arena->written_pages;
+	uint64_t total = nr_pages_of(arena->arena_size);
+	uint64_t first = *page, last;
+
+	while (first < total && !is_written(bitmap, first))
+		first += first % 8 == 0 && !bitmap[first / 8] ? 8 : 1;
+	if (first >= total)
+		return 0;
+
+	last = first;
+	while (last < total && is_written(bitmap, last))
+		last += last % 8 == 0 && bitmap[last / 8] == 0xFF ? 8 : 1;
+	if (last > total)
+		last = total;
+
+	*page = first;
+	*nr_pages = last - first;
+	return 1;
+}
+
+static uint64_t count_runs(const arena_t *arena)
+{
+	uint64_t page = 0, nr_pages, nr_runs = 0;
+
+	while (next_run(arena, &page, &nr_pages)) {
+		nr_runs++;
+		page += nr_pages;
+	}
+	return nr_runs;
+}
+
+// Writes the blocks, then the miniblocks of every block. Returns 0 if a write
+// failed.
+static int save_blocks(arena_t *arena, FILE *file)
+{
+	int ok = 1;
+
+	for (avl_node_t *node = avl_first(arena->alloc_tree); node;
+		 node = avl_next(node)) {
+		block_t *block = (block_t *)node->data;
+		ckpt_block_t record = {block->start_address, block->size,
+			((list_t *)block->miniblock_list)->total_elements};
+		ok &= fwrite(&record, sizeof(record), 1, file) == 1;
+	}
+
+	for (avl_node_t *node = avl_first(arena->alloc_tree); node;
+		 node = avl_next(node)) {
+		list_t *miniblock_list = ((block_t *)node->data)->miniblock_list;
+		for (node_t *curr = miniblock_list->head; curr; curr = curr->next) {
+			miniblock_t *minib = (miniblock_t *)curr->data;
+			ckpt_minib_t record = {minib->size, minib->perm};
+			ok &= fwrite(&record, sizeof(record), 1, file) == 1;
+		}
+	}
+	return ok;
+}
+
+// Writes the runs of written pages, then pads the file up to "data_offset" and
+// writes the bytes of the runs. Returns 0 if a write failed.
+static int save_pages(arena_t *arena, FILE *file, uint64_t tables_end,
+					  uint64_t data_offset)
+{
+	uint64_t page = 0, nr_pages;
+	int ok = 1;
+
+	while (next_run(arena, &page, &nr_pages)) {
+		ckpt_run_t record = {page, nr_pages};
+		ok &= fwrite(&record, sizeof(record), 1, file) == 1;
+		page += nr_pages;
+	}
+
+	for (uint64_t pos = tables_end; pos < data_offset; pos++)
+		ok &= fputc(0, file) != EOF;
+
+	page = 0;
+	while (ok && next_run(arena, &page, &nr_pages)) {
+		ok &= fwrite(arena->base + page * VMA_PAGE_SIZE, VMA_PAGE_SIZE,
+					 nr_pages, file) == nr_pages;
+		page += nr_pages;
+	}
+	return ok;
+}
+
+// The bytes of the bitmap of written bytes that hold the bits of a block.
+static void written_slice(const block_t *block, uint64_t *first,
+						  uint64_t *len)
+{
+	*first = block->start_address / 8;
+	*len = (block->start_address + block->size + 7) / 8 - *first;
+}
+
+// Writes the written bytes of every block(see "checkpoint.h"). Returns 0 if a
+// write failed.
+static int save_written(arena_t *arena, FILE *file)
+{
+	uint64_t first, len;
+	int ok = 1;
+
+	for (avl_node_t *node = avl_first(arena->alloc_tree); ok && node;
+		 node = avl_next(node)) {
+		written_slice((block_t *)node->data, &first, &len);
+		ok = fwrite(arena->written_bytes + first, 1, len, file) == len;
+	}
+	return ok;
+}
+
+// Saves the arena in the file at "path". The checkpoint is written next to it
+// first and only takes the name once it is complete, so a failed SAVE leaves
+// the old file as it was(and an arena loaded from it keeps its pages).
+int save_checkpoint(arena_t *arena, const char *path)
+{
+	char tmp_path[CKPT_MAX_PATH + 8];
+	ckpt_header_t header = {0};
+
+	if (!arena)
+		return VMA_NO_ARENA;
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	FILE *file = fopen(tmp_path, "wb");
+	if (!file)
+		return VMA_FILE_ERROR;
+
+	// The structure and the bytes can't change while they are written.
+	lock_tree(arena->locks, 0);
+	lock_range(arena->locks, 0, arena->arena_size, 0);
+
+	memcpy(header.magic, CKPT_MAGIC, sizeof(header.magic));
+	header.version = CKPT_VERSION;
+	header.page_size = VMA_PAGE_SIZE;
+	header.engine = arena->radix ? VMA_ENGINE_RADIX : VMA_ENGINE_TREE;
+	header.arena_size = arena->arena_size;
+	header.nr_blocks = avl_get_size(arena->alloc_tree);
+	header.nr_miniblocks = avl_get_size(arena->minib_index);
+	header.nr_runs = count_runs(arena);
+	header.nr_written_pages = arena->nr_written_pages;
+
+	uint64_t tables_end = sizeof(header) +
+						  header.nr_blocks * sizeof(ckpt_block_t) +
+						  header.nr_miniblocks * sizeof(ckpt_minib_t) +
+						  header.nr_runs * sizeof(ckpt_run_t);
+	header.data_offset = (tables_end + VMA_PAGE_SIZE - 1) / VMA_PAGE_SIZE *
+						 VMA_PAGE_SIZE;
+	header.checksum = header_checksum(&header);
+
+	int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = ok && save_blocks(arena, file);
+	ok = ok && save_pages(arena, file, tables_end, header.data_offset);
+	ok = ok && save_written(arena, file);
+
+	unlock_range(arena->locks, 0, arena->arena_size);
+	unlock_tree(arena->locks);
+
+	ok &= fclose(file) == 0;
+	if (!ok || rename(tmp_path, path) != 0) {
+		remove(tmp_path);
+		return VMA_FILE_ERROR;
+	}
+	return VMA_OK;
+}
+
+// Verifies that the header belongs to a checkpoint this program can load and
+// that the file is big enough for what it announces.
+static int check_header(const ckpt_header_t *header, uint64_t file_len)
+{
+	if (memcmp(header->magic, CKPT_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != CKPT_VERSION ||
+		header->checksum != header_checksum(header) ||
+		header->page_size != VMA_PAGE_SIZE ||
+		header->engine >= VMA_NR_ENGINES || !header->arena_size)
+		return 0;
+
+	if (header->nr_blocks > file_len / sizeof(ckpt_block_t) ||
+		header->nr_miniblocks > file_len / sizeof(ckpt_minib_t) ||
+		header->nr_runs > file_len / sizeof(ckpt_run_t))
+		return 0;
+
+	uint64_t tables_end = sizeof(*header) +
+						  header->nr_blocks * sizeof(ckpt_block_t) +
+						  header->nr_miniblocks * sizeof(ckpt_minib_t) +
+						  header->nr_runs * sizeof(ckpt_run_t);
+	if (header->data_offset % VMA_PAGE_SIZE ||
+		header->data_offset < tables_end || header->data_offset > file_len)
+		return 0;
+	return header->nr_written_pages <= nr_pages_of(header->arena_size) &&
+		   header->nr_written_pages <=
+		   (file_len - header->data_offset) / VMA_PAGE_SIZE;
+}
+
+// Reads the miniblocks of a block into a new list. Returns NULL if they don't
+// cover the block exactly.
+static list_t *load_miniblocks(const ckpt_block_t *block, FILE *file)
+{
+	list_t *miniblock_list = ll_create(sizeof(miniblock_t));
+	uint64_t address = block->start_address;
+	uint64_t end = block->start_address + block->size;
+	ckpt_minib_t record;
+	int ok = block->nr_miniblocks > 0;
+
+	for (uint64_t i = 0; ok && i < block->nr_miniblocks; i++) {
+		ok = fread(&record, sizeof(record), 1, file) == 1 && record.size &&
+			 record.size <= end - address && record.perm <= 7;
+		if (!ok)
+			break;
+		miniblock_t minib = {address, record.size, record.perm};
+		ll_add_nth_node(miniblock_list, miniblock_list->total_elements,
+						&minib);
+		address += record.size;
+	}
+
+	if (!ok || address != end) {
+		ll_free(&miniblock_list);
+		return NULL;
+	}
+	return miniblock_list;
+}
+
+// Puts a block of the checkpoint in the arena, with all its miniblocks at
+// once: the block goes in the tree, the free zones and the permissions of its
+// pages change once, only the miniblocks are indexed one by one. This is the
+// end of ALLOC_BLOCK without the checks and the merges, as the blocks come
+// ordered and with free zones between them.
+static void place_loaded_block(arena_t *arena, block_t *block)
+{
+	avl_node_t *block_node = avl_insert(arena->alloc_tree,
+										block->start_address, block);
+	list_t *miniblock_list = (list_t *)block->miniblock_list;
+
+	gaps_take(arena->gaps, block->start_address, block->size);
+	perms_allocated(arena, block->start_address, block->size);
+	for (node_t *curr = miniblock_list->head; curr; curr = curr->next) {
+		miniblock_t *minib = (miniblock_t *)curr->data;
+
+		index_miniblock(arena, curr);
+		radix_map(arena->radix, block_node, curr);
+		if (minib->perm != VMA_DEFAULT_PERM)
+			perms_changed(arena, minib->start_address, minib->size,
+						  minib->perm);
+	}
+	arena->allocated_memory += block->size;
+	arena->epoch++;
+}
+
+// Rebuilds the blocks and the miniblocks of a checkpoint in a new arena.
+// Returns 0 if they don't make a valid arena: the blocks must be ordered,
+// inside the arena and never touch each other(they would have been merged).
+static int load_blocks(arena_t *arena, const ckpt_header_t *header,
+					   FILE *file)
+{
+	ckpt_block_t *blocks = malloc(header->nr_blocks * sizeof(*blocks) + 1);
+	uint64_t nr_miniblocks = 0, free_from = 0;
+	block_t block;
+	int ok;
+
+	DIE(!blocks, "malloc failed");
+	ok = fread(blocks, sizeof(*blocks), header->nr_blocks, file) ==
+		 header->nr_blocks;
+
+	for (uint64_t i = 0; ok && i < header->nr_blocks; i++) {
+		ok = blocks[i].start_address >= free_from && blocks[i].size &&
+			 blocks[i].start_address < arena->arena_size &&
+			 blocks[i].size <= arena->arena_size - blocks[i].start_address &&
+			 blocks[i].nr_miniblocks <= header->nr_miniblocks - nr_miniblocks;
+		if (!ok)
+			break;
+
+		block.start_address = blocks[i].start_address;
+		block.size = blocks[i].size;
+		block.miniblock_list = load_miniblocks(&blocks[i], file);
+		ok = block.miniblock_list != NULL;
+		if (ok)
+			place_loaded_block(arena, &block);
+		nr_miniblocks += blocks[i].nr_miniblocks;
+		free_from = block.start_address + block.size + 1;
+	}
+	free(blocks);
+	return ok && nr_miniblocks == header->nr_miniblocks;
+}
+
+// Puts every run of written pages from the file in the arena: the long ones
+// are mapped, the short ones(and the ones that can't be mapped) are read.
+// Returns 0 if the runs don't fit in the arena or the file ends before them.
+static int load_pages(arena_t *arena, const ckpt_header_t *header,
+					  FILE *file)
+{
+	uint64_t nr_pages = nr_pages_of(arena->arena_size);
+	uint64_t next_page = 0, offset = header->data_offset;
+	ckpt_run_t run;
+
+	for (uint64_t i = 0; i < header->nr_runs; i++) {
+		if (fread(&run, sizeof(run), 1, file) != 1 || !run.nr_pages ||
+			run.first_page < next_page || run.first_page >= nr_pages ||
+			run.nr_pages > nr_pages - run.first_page ||
+			run.nr_pages > header->nr_written_pages - arena->nr_written_pages)
+			return 0;
+
+		uint64_t address = run.first_page * VMA_PAGE_SIZE;
+		uint64_t size = run.nr_pages * VMA_PAGE_SIZE;
+		if (run.nr_pages >= CKPT_MIN_MAPPED &&
+			mem_map_file(arena->base + address, size, file, offset))
+			arena->file_backed = 1;
+		else if (!mem_read_file(arena->base + address, size, file, offset))
+			return 0;
+		mark_pages_written(arena, address, size);
+		next_page = run.first_page + run.nr_pages;
+		offset += size;
+	}
+	return arena->nr_written_pages == header->nr_written_pages;
+}
+
+// Reads the written bytes of every block, which follow the bytes of the pages.
+// Returns 0 if the file ends before them.
+static int load_written(arena_t *arena, const ckpt_header_t *header,
+						FILE *file)
+{
+	uint64_t first, len, counted = 0;
+	int ok = fseek(file, header->data_offset + header->nr_written_pages *
+				   VMA_PAGE_SIZE, SEEK_SET) == 0;
+
+	// Two blocks can share a byte of the bitmap, it is only counted once.
+	for (avl_node_t *node = avl_first(arena->alloc_tree); ok && node;
+		 node = avl_next(node)) {
+		written_slice((block_t *)node->data, &first, &len);
+		ok = fread(arena->written_bytes + first, 1, len, file) == len;
+		if (first < counted) {
+			len -= counted - first;
+			first = counted;
+		}
+		arena->nr_written_bytes += count_written(arena, first, len);
+		counted = first + len;
+	}
+	return ok;
+}
+
+// Builds a new arena from the checkpoint at "path". The arena is only given
+// back if the whole checkpoint is valid.
+int load_checkpoint(const char *path, arena_t **arena)
+{
+	ckpt_header_t header;
+
+	*arena = NULL;
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return VMA_FILE_ERROR;
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+		!check_header(&header, file_size(file))) {
+		fclose(file);
+		return VMA_INVALID_CHECKPOINT;
+	}
+
+	arena_t *new_arena = alloc_arena(header.arena_size);
+	if (!new_arena) {
+		fclose(file);
+		return VMA_INVALID_SIZE;
+	}
+	int ok = header.engine != VMA_ENGINE_RADIX ||
+			 make_radix(new_arena) == VMA_OK;
+	ok = ok && load_blocks(new_arena, &header, file);
+	ok = ok && load_pages(new_arena, &header, file);
+	ok = ok && load_written(new_arena, &header, file);
+	fclose(file);
+
+	if (!ok) {
+		dealloc_arena(new_arena);
+		return VMA_INVALID_CHECKPOINT;
+	}
+	*arena = new_arena;
+	return VMA_OK;
+}
@@ -0,0 +1,60 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+#include "vma.h"
+
+// A checkpoint of an arena on disk(SAVE, LOAD). The file starts with a header,
+// followed by the blocks, the miniblocks of each block in order(only their
+// sizes and permissions, as they are contiguous), the runs of written pages
+// and then, from a page-aligned offset, the bytes of the written pages, one
+// run after the other, and at last the bitmap of the written bytes of each
+// block(the bytes of the bitmap that hold its bits, so blocks sharing one
+// write it twice). LOAD maps the runs of at least CKPT_MIN_MAPPED pages over
+// the arena(privately, so the file itself never changes) and the system reads
+// a page from the file the first time it is touched. The shorter runs are
+// copied: every mapping is an area of its own for the system, which only
+// allows a process so many of them(vm.max_map_count), and a sparse arena
+// would need one for every page. The numbers are in the byte order of the
+// machine.
+// The header has a checksum, so a damaged one is refused before the arena is
+// reserved; the tables are checked as they are loaded.
+#define CKPT_MAGIC "VMACKPT"
+#define CKPT_VERSION 2
+#define CKPT_MAX_PATH 4096	// the bytes of a file name, the terminator included
+#define CKPT_MIN_MAPPED 16	// the pages of the shortest run LOAD maps
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t page_size;	 // VMA_PAGE_SIZE
+	uint32_t engine;  // VMA_ENGINE_TREE, ...
+	uint32_t unused;
+	uint64_t arena_size;
+	uint64_t nr_blocks;
+	uint64_t nr_miniblocks;
+	uint64_t nr_runs;
+	uint64_t nr_written_pages;
+	uint64_t data_offset;  // where the bytes of the pages begin
+	uint64_t checksum;	// of the fields above(FNV-1a)
+} ckpt_header_t;
+
+typedef struct {
+	uint64_t start_address;
+	uint64_t size;
+	uint64_t nr_miniblocks;
+} ckpt_block_t;
+
+typedef struct {
+	uint64_t size;
+	uint64_t perm;
+} ckpt_minib_t;
+
+typedef struct {
+	uint64_t first_page;
+	uint64_t nr_pages;
+} ckpt_run_t;
+
+// ===== Checkpoint functions =====
+int save_checkpoint(arena_t *arena, const char *path);
+int load_checkpoint(const char *path, arena_t **arena);
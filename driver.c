@@ -0,0 +1,391 @@
+// Similea Alin-Andrei 314CA
+#include "driver.h"
+
+#include "bulk.h"
+#include "checkpoint.h"
+#include "gaps.h"
+#include "metrics.h"
+#include "vector.h"
+
+// Reads the addresses and the sizes of "nr_segs" zones from the words of a
+// line, starting from "curr"(the line ends at "end"). Returns where the last
+// word ends(NULL if there are not enough words).
+static char *parse_segments(char *curr, char *end, segment_t *segs,
+							uint32_t nr_segs)
+{
+	for (uint32_t i = 0; i < 2 * nr_segs; i++) {
+		while (curr < end && *curr == ' ')
+			curr++;
+		char *word = curr;
+		while (curr < end && *curr != ' ')
+			curr++;
+		if (word == curr)
+			return NULL;
+
+		uint64_t number = parse_number(word, curr - word);
+		if (i % 2)
+			segs[i / 2].size = number;
+		else
+			segs[i / 2].address = number;
+	}
+	return curr;
+}
+
+// The number of zones of a READV or a WRITEV, 0 if the words of the line don't
+// match it.
+static uint64_t vector_count(const command_t *cmd)
+{
+	uint64_t nr_segs = command_number(cmd, 1);
+	int writing = cmd->type == 18;
+
+	if (nr_segs == 0 || nr_segs > VMA_MAX_SEGMENTS ||
+		(uint64_t)cmd->nr_param < 2 + 2 * nr_segs ||
+		(!writing && (uint64_t)cmd->nr_param != 2 + 2 * nr_segs))
+		return 0;
+	return nr_segs;
+}
+
+// Runs a READV or a WRITEV: the number of zones, then the address and the size
+// of each one and, for a WRITEV, the data of all of them, one after another.
+static void handle_vector(arena_t *arena, command_t *cmd, input_t *in,
+						  char *line, size_t line_len, FILE *out)
+{
+	uint64_t nr_segs = vector_count(cmd), offset = 0, total = 0;
+	int writing = cmd->type == 18;
+
+	if (!nr_segs) {
+		check_parameters(0, cmd->nr_param, out);
+		return;
+	}
+
+	segment_t *segs = malloc(nr_segs * sizeof(*segs));
+	DIE(!segs, "malloc failed");
+	char *end = line + line_len;
+	char *rest = parse_segments(cmd->word[1] + cmd->word_len[1], end, segs,
+								nr_segs);
+	if (!writing) {
+		read_vector(arena, segs, nr_segs, out);
+		free(segs);
+		return;
+	}
+
+	// The data begins right after the delimiter of the last size, like the
+	// data of a WRITE, and each zone takes its part of it.
+	rest++;
+	uint64_t rest_len = rest <= end ? (uint64_t)(end - rest) : 0;
+	int status = write_segments(arena, segs, nr_segs);
+	int ok = status == VMA_OK || status == VMA_TRUNCATED;
+	for (uint64_t i = 0; i < nr_segs; i++)
+		total += ok ? segs[i].length : 0;
+	print_status(status, "Writing", total, out);
+	for (uint64_t i = 0; i < nr_segs; i++) {
+		read_payload_from(in, rest, rest_len, offset,
+						  ok ? arena->base + segs[i].address : NULL,
+						  ok ? segs[i].length : 0, segs[i].size);
+		offset += segs[i].size;
+	}
+	if (ok)
+		release_segments(arena, segs, nr_segs);
+	free(segs);
+}
+
+static void handle_alloc_arena(arena_table_t *arenas, command_t *cmd,
+							   FILE *out)
+{
+	int engine = arenas->engine;
+
+	if (cmd->nr_param == 3)
+		engine = engine_type(cmd->word[2], cmd->word_len[2]);
+	if (engine < 0) {
+		check_parameters(0, cmd->nr_param, out);
+		return;
+	}
+	print_status(create_arena(arenas, cmd->arena, command_number(cmd, 1),
+							  engine), NULL, 0, out);
+}
+
+// With a handle, only that arena goes away. Without one, all of them do and
+// the program ends(returns 1).
+static int handle_dealloc_arena(arena_table_t *arenas, command_t *cmd,
+								FILE *out)
+{
+	dump_metrics();
+	if (cmd->has_arena) {
+		print_status(destroy_arena(arenas, cmd->arena), NULL, 0, out);
+		return 0;
+	}
+	destroy_all_arenas(arenas);
+	return 1;
+}
+
+// The data of a WRITE begins right after the delimiter of the size and goes
+// straight from the input to the arena.
+static void handle_write(arena_t *arena, command_t *cmd, input_t *in,
+						 char *line, size_t line_len, FILE *out)
+{
+	uint64_t address = command_number(cmd, 1);
+	uint64_t size = command_number(cmd, 2);
+	char *rest = cmd->word[2] + cmd->word_len[2] + 1;
+	uint64_t rest_len = rest <= line + line_len ?
+						(uint64_t)(line + line_len - rest) : 0;
+	uint64_t to_write;
+	uint8_t *dest;
+
+	int status = write_destination(arena, address, size, &dest, &to_write);
+	print_status(status, "Writing", to_write, out);
+	read_payload(in, rest, rest_len, dest, to_write, size);
+	if (dest)
+		release_range(arena, address, to_write);
+}
+
+// Tells whether the second word of the command is the given option.
+static int has_option(command_t *cmd, const char *option)
+{
+	return cmd->word_len[1] == strlen(option) &&
+		   memcmp(cmd->word[1], option, cmd->word_len[1]) == 0;
+}
+
+static void handle_pmap(arena_t *arena, command_t *cmd, FILE *out)
+{
+	if (cmd->nr_param == 2 && !has_option(cmd, "-v")) {
+		check_parameters(0, cmd->nr_param, out);
+		return;
+	}
+	pmap(arena, cmd->nr_param == 2, out);
+}
+
+// The permissions are the rest of the line, after the length of the zone, if
+// it is given.
+static void handle_mprotect(arena_t *arena, command_t *cmd, FILE *out)
+{
+	uint64_t address = command_number(cmd, 1);
+	char *rest = cmd->word[1] + cmd->word_len[1] + 1;
+
+	if ((unsigned int)(cmd->word[2][0] - '0') >= 10) {
+		print_status(mprotect(arena, address,
+							  find_permission((int8_t *)rest)), NULL, 0, out);
+		return;
+	}
+	if (cmd->nr_param < 4) {
+		check_parameters(0, cmd->nr_param, out);
+		return;
+	}
+	rest = cmd->word[2] + cmd->word_len[2] + 1;
+	print_status(mprotect_range(arena, address, command_number(cmd, 2),
+								find_permission((int8_t *)rest)), NULL, 0, out);
+}
+
+static void handle_alloc_auto(arena_t *arena, command_t *cmd, FILE *out)
+{
+	uint64_t size = command_number(cmd, 1);
+	uint64_t align = cmd->nr_param > 2 ? command_number(cmd, 2) : 1;
+	uint64_t address;
+	int fit = VMA_FIRST_FIT;
+
+	if (cmd->nr_param > 3)
+		fit = fit_type(cmd->word[3], cmd->word_len[3]);
+	if (fit < 0) {
+		check_parameters(0, cmd->nr_param, out);
+		return;
+	}
+	if (!print_status(alloc_auto(arena, size, align, fit, &address), NULL, 0,
+					  out))
+		fprintf(out, "0x%lX\n", address);
+}
+
+static void handle_stats(arena_t *arena, command_t *cmd, FILE *out)
+{
+	if (cmd->nr_param == 1) {
+		print_stats(arena, out);
+		return;
+	}
+	if (!has_option(cmd, "-c")) {
+		check_parameters(0, cmd->nr_param, out);
+		return;
+	}
+	print_metrics(out);
+}
+
+// SAVE and LOAD take the name of the file.
+static void handle_checkpoint(arena_table_t *arenas, arena_t *arena,
+							  command_t *cmd, FILE *out)
+{
+	char path[CKPT_MAX_PATH];
+	int status;
+
+	if (cmd->word_len[1] >= CKPT_MAX_PATH) {
+		check_parameters(0, cmd->nr_param, out);
+		return;
+	}
+	memcpy(path, cmd->word[1], cmd->word_len[1]);
+	path[cmd->word_len[1]] = '\0';
+	if (cmd->type == 11)
+		status = save_checkpoint(arena, path);
+	else
+		status = load_arena(arenas, cmd->arena, path);
+	print_status(status, NULL, 0, out);
+}
+
+static void handle_memset(arena_t *arena, command_t *cmd, FILE *out)
+{
+	uint64_t address = command_number(cmd, 1);
+	uint64_t size = command_number(cmd, 2);
+	uint64_t done;
+
+	if (command_number(cmd, 3) > 0xFF) {
+		check_parameters(0, cmd->nr_param, out);
+		return;
+	}
+	int status = bulk_set(arena, address, size, command_number(cmd, 3), &done);
+	print_status(status, "Setting", done, out);
+}
+
+// MEMCPY and MEMMOVE take the destination, the source and the size.
+static void handle_copy(arena_t *arena, command_t *cmd, FILE *out)
+{
+	uint64_t done;
+	int status = bulk_copy(arena, command_number(cmd, 1),
+						   command_number(cmd, 2), command_number(cmd, 3),
+						   cmd->type == 15, &done);
+
+	print_status(status, cmd->type == 14 ? "Copying" : "Moving", done,
+				 out);
+}
+
+static void handle_memcmp(arena_t *arena, command_t *cmd, FILE *out)
+{
+	uint64_t done;
+	int result;
+	int status = bulk_compare(arena, command_number(cmd, 1),
+							  command_number(cmd, 2), command_number(cmd, 3),
+							  &result, &done);
+
+	if (!print_status(status, "Comparing", done, out))
+		fprintf(out, "%d\n", result);
+}
+
+// Runs a command once its number of parameters was checked. Returns 1 when the
+// program should end.
+static int execute(arena_table_t *arenas, command_t *cmd, input_t *in,
+				   char *line, size_t line_len, FILE *out)
+{
+	if (!check_parameters(cmd->type, cmd->nr_param, out))
+		return 0;
+	arena_t *arena = get_arena(arenas, cmd->arena);
+
+	switch (cmd->type) {
+		case 1:	 // ALLOC_ARENA size [TREE | RADIX]
+			handle_alloc_arena(arenas, cmd, out);
+			break;
+
+		case 2:	 // DEALLOC_ARENA
+			return handle_dealloc_arena(arenas, cmd, out);
+
+		case 3:	 // ALLOC_BLOCK address size
+			print_status(alloc_block(arena, command_number(cmd, 1),
+									 command_number(cmd, 2)), NULL, 0, out);
+			break;
+
+		case 4:	 // FREE_BLOCK address
+			print_status(free_block(arena, command_number(cmd, 1)), NULL, 0,
+						 out);
+			break;
+
+		case 5:	 // READ address size
+			read(arena, command_number(cmd, 1), command_number(cmd, 2), out);
+			break;
+
+		case 6:	 // WRITE address size data
+			handle_write(arena, cmd, in, line, line_len, out);
+			break;
+
+		case 7:	 // PMAP [-v]
+			handle_pmap(arena, cmd, out);
+			break;
+
+		case 8:	 // MPROTECT address [length] permissions
+			handle_mprotect(arena, cmd, out);
+			break;
+
+		case 9:	 // ALLOC_AUTO size [alignment [policy]]
+			handle_alloc_auto(arena, cmd, out);
+			break;
+
+		case 10:  // STATS [-c]
+			handle_stats(arena, cmd, out);
+			break;
+
+		case 11:  // SAVE file
+		case 12:  // LOAD file
+			handle_checkpoint(arenas, arena, cmd, out);
+			break;
+
+		case 13:  // MEMSET address size byte
+			handle_memset(arena, cmd, out);
+			break;
+
+		case 14:  // MEMCPY destination source size
+		case 15:  // MEMMOVE destination source size
+			handle_copy(arena, cmd, out);
+			break;
+
+		case 16:  // MEMCMP first second size
+			handle_memcmp(arena, cmd, out);
+			break;
+
+		case 17:  // READV count address size [address size ...]
+		case 18:  // WRITEV count address size [address size ...] data
+			handle_vector(arena, cmd, in, line, line_len, out);
+			break;
+	}
+	return 0;
+}
+
+// Runs a command line of the text driver, already split into words. The
+// results are printed to "out". Returns 1 when the program
+// should end(a DEALLOC_ARENA without a handle, all the arenas are gone).
+int run_command(arena_table_t *arenas, command_t *cmd, input_t *in,
+				char *line, size_t line_len, FILE *out)
+{
+	metrics_begin(cmd->type);
+	int end = execute(arenas, cmd, in, line, line_len, out);
+	metrics_end();
+	return end;
+}
+
+// How many bytes of the input after the line are the data of the command, the
+// ones "read_payload" takes for it: the data that doesn't fit on the rest of
+// the line goes on over the '\n' and into the next lines. It only depends on
+// the words of the line, not on the arenas.
+uint64_t command_payload(command_t *cmd, char *line, size_t line_len)
+{
+	uint64_t size = 0, nr_segs = cmd->type == 18 ? vector_count(cmd) : 0;
+	char *rest;
+
+	if (cmd->type == 6 && cmd->nr_param >= 3) {
+		size = command_number(cmd, 2);
+		rest = cmd->word[2] + cmd->word_len[2] + 1;
+	} else if (nr_segs) {
+		segment_t *segs = malloc(nr_segs * sizeof(*segs));
+		DIE(!segs, "malloc failed");
+		rest = parse_segments(cmd->word[1] + cmd->word_len[1],
+							  line + line_len, segs, nr_segs) + 1;
+		for (uint64_t i = 0; i < nr_segs; i++)
+			size = size + segs[i].size < size ? UINT64_MAX
+											  : size + segs[i].size;
+		free(segs);
+	} else {
+		return 0;
+	}
+
+	uint64_t rest_len = rest <= line + line_len ?
+						(uint64_t)(line + line_len - rest) : 0;
+	return size > rest_len ? size - rest_len - 1 : 0;
+}
+
+// Whether the command ends the program: a DEALLOC_ARENA without a handle, no
+// matter the state of the arenas.
+int command_ends(const command_t *cmd)
+{
+	return cmd->type == 2 && cmd->nr_param == 1 && !cmd->has_arena;
+}
@@ -0,0 +1,13 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+
+#include "input.h"
+#include "vma.h"
+
+// ===== Text driver functions =====
+int run_command(arena_table_t *arenas, command_t *cmd, input_t *in,
+				char *line, size_t line_len, FILE *out);
+uint64_t command_payload(command_t *cmd, char *line, size_t line_len);
+int command_ends(const command_t *cmd);
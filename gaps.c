@@ -0,0 +1,196 @@
+// Similea Alin-Andrei 314CA
+#include "gaps.h"
+
+#include "vma.h"
+
+static uint64_t gap_size_of(const void *data)
+{
+	return ((const gap_t *)data)->size;
+}
+
+// The gaps of the same size are ordered by their start address, the key of
+// their node in the tree by address.
+static uint64_t gap_start_of(const void *data)
+{
+	return (*(avl_node_t *const *)data)->key;
+}
+
+// Creates the index of an empty arena: a single gap, if the arena isn't empty.
+gap_index_t *gaps_create(uint64_t arena_size)
+{
+	gap_index_t *gaps = pool_alloc(pool_get(sizeof(*gaps)));
+
+	gaps->by_address = avl_create(sizeof(gap_t));
+	gaps->by_address->value_of = gap_size_of;
+	gaps->by_size = avl_create(sizeof(avl_node_t *));
+	gaps->by_size->tie_of = gap_start_of;
+	gaps->next_fit = 0;
+	if (arena_size)
+		gaps_give(gaps, 0, arena_size);
+
+	return gaps;
+}
+
+void gaps_destroy(gap_index_t *gaps)
+{
+	avl_free(&gaps->by_address);
+	avl_free(&gaps->by_size);
+	pool_free(pool_get(sizeof(*gaps)), gaps);
+}
+
+static void add_gap(gap_index_t *gaps, uint64_t start, uint64_t size)
+{
+	gap_t gap = {start, size, NULL};
+	avl_node_t *node = avl_insert(gaps->by_address, start, &gap);
+
+	((gap_t *)node->data)->by_size = avl_insert(gaps->by_size, size, &node);
+}
+
+static void remove_gap(gap_index_t *gaps, avl_node_t *node)
+{
+	avl_remove(gaps->by_size, ((gap_t *)node->data)->by_size);
+	avl_remove(gaps->by_address, node);
+}
+
+// Changes the borders of a gap. The gap can't move past its neighbours, so
+// its node stays where it is in the tree by address.
+static void resize_gap(gap_index_t *gaps, avl_node_t *node, uint64_t start,
+					   uint64_t size)
+{
+	gap_t *gap = (gap_t *)node->data;
+
+	avl_remove(gaps->by_size, gap->by_size);
+	node->key = start;
+	gap->start_address = start;
+	gap->size = size;
+	avl_update_value(gaps->by_address, node);
+	gap->by_size = avl_insert(gaps->by_size, size, &node);
+}
+
+// A block was placed at [address, address + size), which is inside a gap.
+void gaps_take(gap_index_t *gaps, uint64_t address, uint64_t size)
+{
+	avl_node_t *node = avl_floor(gaps->by_address, address);
+	gap_t *gap = (gap_t *)node->data;
+	uint64_t left = address - gap->start_address;
+	uint64_t right = gap->start_address + gap->size - (address + size);
+
+	if (!left && !right) {
+		remove_gap(gaps, node);
+	} else if (!left) {
+		resize_gap(gaps, node, address + size, right);
+	} else {
+		resize_gap(gaps, node, gap->start_address, left);
+		if (right)
+			add_gap(gaps, address + size, right);
+	}
+}
+
+// The zone [address, address + size) was freed. It is merged with the gaps
+// right before and right after it.
+void gaps_give(gap_index_t *gaps, uint64_t address, uint64_t size)
+{
+	avl_node_t *prev = avl_floor(gaps->by_address, address);
+	avl_node_t *next = prev ? avl_next(prev) : avl_first(gaps->by_address);
+	gap_t *prev_gap = prev ? (gap_t *)prev->data : NULL;
+	gap_t *next_gap = next ? (gap_t *)next->data : NULL;
+
+	if (prev_gap && prev_gap->start_address + prev_gap->size != address)
+		prev = NULL;
+	if (next_gap && next_gap->start_address != address + size)
+		next = NULL;
+
+	if (prev && next) {
+		uint64_t next_size = next_gap->size;
+		remove_gap(gaps, next);
+		resize_gap(gaps, prev, prev_gap->start_address,
+				   prev_gap->size + size + next_size);
+	} else if (prev) {
+		resize_gap(gaps, prev, prev_gap->start_address, prev_gap->size + size);
+	} else if (next) {
+		resize_gap(gaps, next, address, size + next_gap->size);
+	} else {
+		add_gap(gaps, address, size);
+	}
+}
+
+// Tells whether a block fits in the gap once its start is aligned, and where.
+static int fits(const gap_t *gap, uint64_t size, uint64_t align,
+				uint64_t *address)
+{
+	uint64_t start = (gap->start_address + align - 1) & ~(align - 1);
+
+	if (start < gap->start_address ||
+		start - gap->start_address + size > gap->size)
+		return 0;
+	*address = start;
+	return 1;
+}
+
+// Returns the gap with the lowest address, starting at "from" or later, where
+// the block fits aligned. The subtrees without a gap of at least "size" bytes
+// are skipped as a whole.
+static avl_node_t *first_fit(avl_node_t *node, uint64_t from, uint64_t size,
+							 uint64_t align, uint64_t *address)
+{
+	if (!node || node->max_value < size)
+		return NULL;
+	if (node->key < from)
+		return first_fit(node->right, from, size, align, address);
+
+	avl_node_t *found = first_fit(node->left, from, size, align, address);
+	if (found)
+		return found;
+	if (fits((gap_t *)node->data, size, align, address))
+		return node;
+	return first_fit(node->right, from, size, align, address);
+}
+
+// Returns the smallest gap where the block fits aligned(the lowest one of
+// them). The gaps are tried from the first one of "size" bytes on, by size.
+static avl_node_t *best_fit(gap_index_t *gaps, uint64_t size, uint64_t align,
+							uint64_t *address)
+{
+	avl_node_t *node = avl_ceil(gaps->by_size, size);
+
+	for (; node; node = avl_next(node)) {
+		avl_node_t *gap = *(avl_node_t **)node->data;
+		if (fits((gap_t *)gap->data, size, align, address))
+			return gap;
+	}
+	return NULL;
+}
+
+// Chooses where a block of "size" bytes goes, at an address that is a multiple
+// of "align"(a power of two). Returns 0 if no gap was found. The index itself
+// doesn't change until the block is placed("gaps_take"). Without an alignment
+// the first gap big enough is the answer, found in O(log n). With one, the
+// gaps big enough where the aligned block doesn't fit are also passed over,
+// at most the ones of less than "size + align - 1" bytes(in a bigger one the
+// block fits wherever it starts).
+int gaps_find(gap_index_t *gaps, uint64_t size, uint64_t align, int fit,
+			  uint64_t *address)
+{
+	avl_node_t *root = gaps->by_address->root;
+	avl_node_t *node = NULL;
+
+	if (!root || size > root->max_value)
+		return 0;
+
+	if (fit == VMA_BEST_FIT) {
+		node = best_fit(gaps, size, align, address);
+	} else if (fit == VMA_NEXT_FIT) {
+		// From the gap the last block ended in, then from the start.
+		avl_node_t *last = avl_floor(gaps->by_address, gaps->next_fit);
+		node = first_fit(root, last ? last->key : 0, size, align, address);
+		if (!node)
+			node = first_fit(root, 0, size, align, address);
+	} else {
+		node = first_fit(root, 0, size, align, address);
+	}
+
+	if (!node)
+		return 0;
+	gaps->next_fit = *address + size;
+	return 1;
+}
@@ -0,0 +1,37 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+#include "avl.h"
+
+// The free zones(gaps) between the blocks of an arena, kept next to the tree
+// of blocks so a block can be placed without giving its address. Each gap is
+// in two trees: by address, where every node also knows the biggest gap of its
+// subtree(first fit and next fit), and by size and then address(best fit).
+typedef struct {
+	uint64_t start_address;
+	uint64_t size;
+	avl_node_t *by_size;  // the node of the gap in the tree by size
+} gap_t;
+
+typedef struct gap_index {
+	avl_t *by_address;	// gaps by start address
+	avl_t *by_size;	 // the nodes of "by_address", by the size of their gap
+	uint64_t next_fit;	// where the last block placed by the index ends
+} gap_index_t;
+
+// How a free zone is chosen for a block.
+enum {
+	VMA_FIRST_FIT,	// the one with the lowest address
+	VMA_BEST_FIT,  // the smallest one
+	VMA_NEXT_FIT,  // the first one after the last block placed
+	VMA_NR_FITS
+};
+
+// ===== Free zone functions =====
+gap_index_t *gaps_create(uint64_t arena_size);
+void gaps_destroy(gap_index_t *gaps);
+void gaps_take(gap_index_t *gaps, uint64_t address, uint64_t size);
+void gaps_give(gap_index_t *gaps, uint64_t address, uint64_t size);
+int gaps_find(gap_index_t *gaps, uint64_t size, uint64_t align, int fit,
+			  uint64_t *address);
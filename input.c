@@ -0,0 +1,127 @@
+// Similea Alin-Andrei 314CA
+#include "input.h"
+
+#include "vma.h"
+
+#define INPUT_BUFFER_SIZE (1 << 16)
+
+// Initializes a reader for the given file.
+void input_init(input_t *in, FILE *file)
+{
+	in->file = file;
+	in->capacity = INPUT_BUFFER_SIZE;
+	in->buffer = malloc(in->capacity);
+	DIE(!in->buffer, "malloc failed");
+	in->pos = 0;
+	in->end = 0;
+}
+
+// Initializes a reader over bytes already in memory(the data of a command in
+// the pipelined driver): the input ends with them. The bytes stay owned by the
+// caller, so the reader is only used with "input_read" and never destroyed.
+void input_init_bytes(input_t *in, char *bytes, size_t size)
+{
+	in->file = NULL;
+	in->buffer = bytes;
+	in->capacity = size;
+	in->pos = 0;
+	in->end = size;
+}
+
+// Frees the buffer of the reader.
+void input_destroy(input_t *in)
+{
+	free(in->buffer);
+	in->buffer = NULL;
+}
+
+// Moves the unread bytes to the beginning of the buffer and fills the rest of
+// it from the file. Returns how many new bytes were read.
+static size_t input_refill(input_t *in)
+{
+	if (!in->file)
+		return 0;
+
+	memmove(in->buffer, in->buffer + in->pos, in->end - in->pos);
+	in->end -= in->pos;
+	in->pos = 0;
+
+	if (in->end == in->capacity) {
+		// A line bigger than the buffer: make room for the rest of it.
+		in->capacity *= 2;
+		in->buffer = realloc(in->buffer, in->capacity);
+		DIE(!in->buffer, "realloc failed");
+	}
+
+	size_t nr_read = fread(in->buffer + in->end, 1, in->capacity - in->end,
+						   in->file);
+	in->end += nr_read;
+	return nr_read;
+}
+
+// Returns the next line, with its '\n' replaced by the string terminator, and
+// stores its length in "len". The line stays in the buffer, so it is only
+// valid until the next call. Returns NULL when there are no lines left.
+char *input_line(input_t *in, size_t *len)
+{
+	char *newline = memchr(in->buffer + in->pos, '\n', in->end - in->pos);
+
+	while (!newline) {
+		size_t searched = in->end - in->pos;
+
+		if (!input_refill(in)) {
+			// The last line doesn't end with '\n'.
+			if (in->end == in->pos)
+				return NULL;
+			if (in->end == in->capacity)
+				input_refill(in);  // only to make room for the terminator
+			newline = in->buffer + in->end;
+			in->end++;
+			break;
+		}
+		newline = memchr(in->buffer + in->pos + searched, '\n',
+						 in->end - in->pos - searched);
+	}
+
+	char *line = in->buffer + in->pos;
+	*newline = '\0';
+	*len = newline - line;
+	in->pos = newline - in->buffer + 1;
+
+	return line;
+}
+
+// Copies the next "size" bytes of the input to "dest" or, if "dest" is NULL,
+// just skips them. Returns how many bytes there were (less than "size" only at
+// the end of the input).
+uint64_t input_read(input_t *in, void *dest, uint64_t size)
+{
+	uint64_t done = 0;
+
+	while (done < size) {
+		size_t avail = in->end - in->pos;
+
+		if (!avail) {
+			// Big payloads go straight from the file to their destination.
+			if (in->file && dest && size - done >= in->capacity) {
+				size_t nr_read = fread((char *)dest + done, 1, size - done,
+									   in->file);
+				done += nr_read;
+				if (!nr_read)
+					break;
+				continue;
+			}
+			if (!input_refill(in))
+				break;
+			avail = in->end - in->pos;
+		}
+
+		uint64_t chunk = size - done < avail ? size - done : avail;
+		if (dest)
+			memcpy((char *)dest + done, in->buffer + in->pos, chunk);
+		in->pos += chunk;
+		done += chunk;
+	}
+
+	return done;
+}
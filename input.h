@@ -0,0 +1,23 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Buffered reader for the commands: the lines are handed out in place, from a
+// big buffer that is refilled with a single fread, and the data of a WRITE is
+// copied straight from that buffer.
+typedef struct {
+	FILE *file;
+	char *buffer;
+	size_t capacity;
+	size_t pos;	 // the unread bytes are buffer[pos..end)
+	size_t end;
+} input_t;
+
+// ===== Input functions =====
+void input_init(input_t *in, FILE *file);
+void input_init_bytes(input_t *in, char *bytes, size_t size);
+void input_destroy(input_t *in);
+char *input_line(input_t *in, size_t *len);
+uint64_t input_read(input_t *in, void *dest, uint64_t size);
@@ -8,49 +8,82 @@ list_t *ll_create(unsigned int data_size)
 {
 	list_t *ll;
 
-	ll = malloc(sizeof(*ll));
-	DIE(!ll, "malloc failed");
+	ll = pool_alloc(pool_get(sizeof(*ll)));
 
 	ll->head = NULL;
+	ll->tail = NULL;
 	ll->data_size = data_size;
 	ll->total_elements = 0;
+	ll->pool = pool_get(sizeof(node_t) + data_size);
 
 	return ll;
 }
 
-// Adds a new node with "new_data" to the position "n" in the list.
-void ll_add_nth_node(list_t *list, unsigned int n, const void *new_data)
+// Adds a new node with "new_data" to the position "n" in the list and returns
+// it.
+node_t *ll_add_nth_node(list_t *list, unsigned int n, const void *new_data)
 {
 	node_t *prev, *curr;
 	node_t *new_node;
 
 	if (!list)
-		return;
+		return NULL;
 
 	if (n > list->total_elements)
 		n = list->total_elements;
 
-	curr = list->head;
-	prev = NULL;
-	while (n > 0) {
-		prev = curr;
-		curr = curr->next;
-		--n;
+	if (n == list->total_elements) {
+		// Adding at the end doesn't need a walk.
+		curr = NULL;
+		prev = list->tail;
+	} else {
+		curr = list->head;
+		prev = NULL;
+		while (n > 0) {
+			prev = curr;
+			curr = curr->next;
+			--n;
+		}
 	}
 
-	new_node = malloc(sizeof(*new_node));
-	DIE(!new_node, "malloc failed");
-	new_node->data = malloc(list->data_size);
-	DIE(!new_node->data, "malloc failed");
+	// The data is kept in the same pool object, right after the node.
+	new_node = pool_alloc(list->pool);
 	memcpy(new_node->data, new_data, list->data_size);
 
 	new_node->next = curr;
+	new_node->prev = prev;
+	if (curr)
+		curr->prev = new_node;
+	else
+		list->tail = new_node;
 	if (!prev) /* n == 0. */
 		list->head = new_node;
 	else
 		prev->next = new_node;
 
 	list->total_elements++;
+
+	return new_node;
+}
+
+// Adds a new node with "new_data" right after the given node and returns it,
+// without a walk.
+node_t *ll_add_after(list_t *list, node_t *node, const void *new_data)
+{
+	node_t *new_node = pool_alloc(list->pool);
+	memcpy(new_node->data, new_data, list->data_size);
+
+	new_node->prev = node;
+	new_node->next = node->next;
+	if (node->next)
+		node->next->prev = new_node;
+	else
+		list->tail = new_node;
+	node->next = new_node;
+
+	list->total_elements++;
+
+	return new_node;
 }
 
 // Removes the "n"th node from the list.
@@ -76,12 +109,80 @@ node_t *ll_remove_nth_node(list_t *list, unsigned int n)
 		list->head = curr->next;
 	else
 		prev->next = curr->next;
+	if (curr->next)
+		curr->next->prev = prev;
+	else
+		list->tail = prev;
 
 	list->total_elements--;
 
 	return curr;
 }
 
+// Unlinks the given node from the list, without having to search for it.
+node_t *ll_remove_node(list_t *list, node_t *node)
+{
+	if (!node->prev)
+		list->head = node->next;
+	else
+		node->prev->next = node->next;
+	if (node->next)
+		node->next->prev = node->prev;
+	else
+		list->tail = node->prev;
+
+	list->total_elements--;
+
+	return node;
+}
+
+// Moves all the nodes of "src" to the beginning (at_head != 0) or to the end of
+// "dst", leaving "src" empty. The nodes are relinked, not copied.
+void ll_splice(list_t *dst, list_t *src, int at_head)
+{
+	if (!src->head)
+		return;
+
+	if (!dst->head) {
+		dst->head = src->head;
+		dst->tail = src->tail;
+	} else if (at_head) {
+		src->tail->next = dst->head;
+		dst->head->prev = src->tail;
+		dst->head = src->head;
+	} else {
+		dst->tail->next = src->head;
+		src->head->prev = dst->tail;
+		dst->tail = src->tail;
+	}
+	dst->total_elements += src->total_elements;
+
+	src->head = NULL;
+	src->tail = NULL;
+	src->total_elements = 0;
+}
+
+// Moves the given node and all the nodes after it to a new list and returns
+// it. The caller gives the number of moved nodes, so nothing is walked.
+list_t *ll_split(list_t *list, node_t *node, unsigned int nr_moved)
+{
+	list_t *new_list = ll_create(list->data_size);
+
+	new_list->head = node;
+	new_list->tail = list->tail;
+	new_list->total_elements = nr_moved;
+
+	list->tail = node->prev;
+	if (node->prev)
+		node->prev->next = NULL;
+	else
+		list->head = NULL;
+	node->prev = NULL;
+	list->total_elements -= nr_moved;
+
+	return new_list;
+}
+
 // Returns the size of the given list.
 unsigned int ll_get_size(list_t *list)
 {
@@ -100,18 +201,21 @@ void ll_free(list_t **pp_list)
 	while (ll_get_size(*pp_list) > 0)
 		free_node(*pp_list, 0);
 
-	free(*pp_list);
+	pool_free(pool_get(sizeof(list_t)), *pp_list);
 	*pp_list = NULL;
 }
 
+// Unlinks the given node from the list and frees its memory.
+void ll_delete_node(list_t *list, node_t *node)
+{
+	ll_remove_node(list, node);
+	pool_free(list->pool, node);
+}
+
 // Frees the memory of the "idx"th node from the given list.
 void free_node(list_t *list, int idx)
 {
 	node_t *removed_node = ll_remove_nth_node(list, idx);
-	if (removed_node->data) {
-		free(removed_node->data);
-		removed_node->data = NULL;
-	}
-	free(removed_node);
+	pool_free(list->pool, removed_node);
 	removed_node = NULL;
 }
@@ -4,22 +4,31 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "pool.h"
+
 typedef struct node_t {
 	struct node_t *prev;
 	struct node_t *next;
-	void *data;
+	unsigned char data[];  // the data, right after the node(aligned to 8)
 } node_t;
 
 typedef struct {
 	node_t *head;
+	node_t *tail;
 	unsigned int data_size;
 	unsigned int total_elements;
+	pool_t *pool;  // nodes, each one followed by its data
 } list_t;
 
 // ===== Linked-list functions =====
 list_t *ll_create(unsigned int data_size);
-void ll_add_nth_node(list_t *list, unsigned int n, const void *new_data);
+node_t *ll_add_nth_node(list_t *list, unsigned int n, const void *new_data);
+node_t *ll_add_after(list_t *list, node_t *node, const void *new_data);
 node_t *ll_remove_nth_node(list_t *list, unsigned int n);
+node_t *ll_remove_node(list_t *list, node_t *node);
+void ll_splice(list_t *dst, list_t *src, int at_head);
+list_t *ll_split(list_t *list, node_t *node, unsigned int nr_moved);
 unsigned int ll_get_size(list_t *list);
 void ll_free(list_t **pp_list);
 void free_node(list_t *list, int idx);
+void ll_delete_node(list_t *list, node_t *node);
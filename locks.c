@@ -0,0 +1,142 @@
+// Similea Alin-Andrei 314CA
+#define _POSIX_C_SOURCE 200809L	 // pthread_rwlock_t
+#include "locks.h"
+
+#include <pthread.h>
+
+#include "vma.h"
+
+struct arena_locks {
+	pthread_rwlock_t tree;
+	pthread_rwlock_t stripes[VMA_NR_STRIPES];
+	pthread_mutex_t snapshot;
+};
+
+// Creates the locks of a concurrent arena.
+arena_locks_t *locks_create(void)
+{
+	arena_locks_t *locks = malloc(sizeof(*locks));
+	DIE(!locks, "malloc failed");
+
+	DIE(pthread_rwlock_init(&locks->tree, NULL), "pthread_rwlock_init failed");
+	for (int i = 0; i < VMA_NR_STRIPES; i++)
+		DIE(pthread_rwlock_init(&locks->stripes[i], NULL),
+			"pthread_rwlock_init failed");
+	DIE(pthread_mutex_init(&locks->snapshot, NULL),
+		"pthread_mutex_init failed");
+	return locks;
+}
+
+void locks_destroy(arena_locks_t *locks)
+{
+	if (!locks)
+		return;
+
+	pthread_rwlock_destroy(&locks->tree);
+	for (int i = 0; i < VMA_NR_STRIPES; i++)
+		pthread_rwlock_destroy(&locks->stripes[i]);
+	pthread_mutex_destroy(&locks->snapshot);
+	free(locks);
+}
+
+void lock_tree(arena_locks_t *locks, int exclusive)
+{
+	if (!locks)
+		return;
+	if (exclusive)
+		pthread_rwlock_wrlock(&locks->tree);
+	else
+		pthread_rwlock_rdlock(&locks->tree);
+}
+
+void unlock_tree(arena_locks_t *locks)
+{
+	if (locks)
+		pthread_rwlock_unlock(&locks->tree);
+}
+
+// The snapshot lock is only taken by the readers of snapshots, never by the
+// operations that change the arena.
+void lock_snapshot(arena_locks_t *locks)
+{
+	if (locks)
+		pthread_mutex_lock(&locks->snapshot);
+}
+
+void unlock_snapshot(arena_locks_t *locks)
+{
+	if (locks)
+		pthread_mutex_unlock(&locks->snapshot);
+}
+
+// Returns the stripes of a zone, one bit for each of them.
+uint64_t stripe_mask(uint64_t address, uint64_t size)
+{
+	if (!size)
+		return 0;
+
+	uint64_t first = address / VMA_STRIPE_SIZE;
+	uint64_t last = (address + size - 1) / VMA_STRIPE_SIZE;
+	if (last - first >= VMA_NR_STRIPES - 1)
+		return ~0ULL;
+
+	uint64_t mask = 0;
+	for (uint64_t region = first; region <= last; region++)
+		mask |= 1ULL << (region % VMA_NR_STRIPES);
+	return mask;
+}
+
+// Takes the given stripes(see "stripe_mask"), in increasing order. The
+// stripes of more than one zone are taken at once, so a stripe they share is
+// only taken once.
+void lock_stripes(arena_locks_t *locks, uint64_t mask, int exclusive)
+{
+	if (!locks)
+		return;
+
+	for (int i = 0; i < VMA_NR_STRIPES; i++) {
+		if (!((mask >> i) & 1))
+			continue;
+		if (exclusive)
+			pthread_rwlock_wrlock(&locks->stripes[i]);
+		else
+			pthread_rwlock_rdlock(&locks->stripes[i]);
+	}
+}
+
+void unlock_stripes(arena_locks_t *locks, uint64_t mask)
+{
+	if (!locks)
+		return;
+
+	for (int i = 0; i < VMA_NR_STRIPES; i++)
+		if ((mask >> i) & 1)
+			pthread_rwlock_unlock(&locks->stripes[i]);
+}
+
+// Takes the stripes of a zone, in increasing order.
+void lock_range(arena_locks_t *locks, uint64_t address, uint64_t size,
+				int exclusive)
+{
+	lock_stripes(locks, stripe_mask(address, size), exclusive);
+}
+
+void unlock_range(arena_locks_t *locks, uint64_t address, uint64_t size)
+{
+	unlock_stripes(locks, stripe_mask(address, size));
+}
+
+// Takes the stripes of two zones of "size" bytes at once, so a copy between
+// them can't wait for itself.
+void lock_ranges(arena_locks_t *locks, uint64_t first, uint64_t second,
+				 uint64_t size, int exclusive)
+{
+	lock_stripes(locks, stripe_mask(first, size) | stripe_mask(second, size),
+				 exclusive);
+}
+
+void unlock_ranges(arena_locks_t *locks, uint64_t first, uint64_t second,
+				   uint64_t size)
+{
+	unlock_stripes(locks, stripe_mask(first, size) | stripe_mask(second, size));
+}
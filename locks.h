@@ -0,0 +1,37 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+// The locks of an arena in concurrent mode. The tree lock guards the trees and
+// the lists of miniblocks: the lookups share it, the changes of the structure
+// take it alone. The bytes of the arena are guarded by striped locks: the
+// address space is cut in regions of VMA_STRIPE_SIZE bytes and every region
+// belongs to one of the VMA_NR_STRIPES stripes, so operations on distant zones
+// rarely meet(a region is a multiple of 8 pages, so each byte of the bitmap of
+// written pages belongs to a single stripe). The snapshot lock is only taken by
+// the readers of snapshots("snapshot.c"). The locks are always taken in this
+// order: snapshot, tree, stripes(the stripes in increasing order).
+// An arena that isn't concurrent has no locks(NULL) and all the functions do
+// nothing for it.
+#define VMA_NR_STRIPES 64
+#define VMA_STRIPE_SIZE (256UL << 10)
+
+typedef struct arena_locks arena_locks_t;
+
+// ===== Lock functions =====
+arena_locks_t *locks_create(void);
+void locks_destroy(arena_locks_t *locks);
+void lock_tree(arena_locks_t *locks, int exclusive);
+void unlock_tree(arena_locks_t *locks);
+void lock_snapshot(arena_locks_t *locks);
+void unlock_snapshot(arena_locks_t *locks);
+uint64_t stripe_mask(uint64_t address, uint64_t size);
+void lock_stripes(arena_locks_t *locks, uint64_t mask, int exclusive);
+void unlock_stripes(arena_locks_t *locks, uint64_t mask);
+void lock_range(arena_locks_t *locks, uint64_t address, uint64_t size,
+				int exclusive);
+void unlock_range(arena_locks_t *locks, uint64_t address, uint64_t size);
+void lock_ranges(arena_locks_t *locks, uint64_t first, uint64_t second,
+				 uint64_t size, int exclusive);
+void unlock_ranges(arena_locks_t *locks, uint64_t first, uint64_t second,
+				   uint64_t size);
@@ -1,86 +1,87 @@
 // Similea Alin-Andrei 314CA
+#include "binary.h"
+#include "driver.h"
 #include "list.h"
+#include "mem.h"
+#include "metrics.h"
+#include "pipeline.h"
 #include "vma.h"
-#define NMAX_LINE 100
+#define OUTPUT_BUFFER_SIZE (1 << 20)
 
-int main(void)
+static int usage(const char *name)
 {
-	char *command;
-	char line[NMAX_LINE], line_copy[NMAX_LINE];
-	char delim[] = "\n ";
-	arena_t *arena = NULL;
-	char *param;
-	uint64_t size, address;
-
-	while (1) {
-		fgets(line, NMAX_LINE, stdin);
-		if (line[0] == '\n')
-			continue;
-		strcpy(line_copy, line);
-
-		int nr_param = nr_of_parameters(line_copy, delim);
-		command = strtok(line, delim);
-		int type = command_type(command);
-		int ok = check_parameters(type, nr_param);
-
-		if (ok)
-			switch (type) {
-				case 1:	 // ALLOC_ARENA
-					param = strtok(NULL, delim);
-					size = atol(param);
-					arena = alloc_arena(size);
-					break;
+	fprintf(stderr, "Usage: %s [--binary | --pipeline] [--radix] "
+			"[--metrics file]\n", name);
+	return 1;
+}
 
-				case 2:	 // DEALLOC_ARENA
-					dealloc_arena(arena);
-					free(arena);
-					arena = NULL;
-					exit(0);
-					break;
+// ./vma            -> commands and replies as text, one per line; a command can
+//                     start with "@<handle>" to choose its arena(0 if missing)
+// ./vma --binary   -> fixed-size binary records(see "binary.h")
+// ./vma --radix    -> the arenas translate their addresses through a page
+//                     table unless ALLOC_ARENA asks for another engine
+// ./vma --metrics file -> every DEALLOC_ARENA adds the metrics to the file, as
+//                     a line of JSON(see "metrics.h")
+// ./vma --pipeline -> text commands, parsed, run and printed by three threads
+//                     (see "pipeline.h"), with the same output
+int main(int argc, char *argv[])
+{
+	char *line;
+	size_t line_len;
+	command_t cmd;
+	arena_table_t arenas;
+	int binary = 0, pipelined = 0;
+	input_t in;
 
-				case 3:	 // ALLOC_BLOCK
-					param = strtok(NULL, delim);
-					address = atol(param);
-					param = strtok(NULL, delim);
-					size = atol(param);
-					alloc_block(arena, address, size);
-					break;
+	arenas_init(&arenas);
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--binary") == 0) {
+			binary = 1;
+		} else if (strcmp(argv[i], "--pipeline") == 0) {
+			pipelined = 1;
+		} else if (strcmp(argv[i], "--radix") == 0) {
+			arenas.engine = VMA_ENGINE_RADIX;
+		} else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc &&
+				   open_metrics_dump(argv[i + 1])) {
+			i++;
+		} else {
+			return usage(argv[0]);
+		}
+	}
+	if (binary && pipelined)
+		return usage(argv[0]);
 
-				case 4:	 // FREE_BLOCK
-					param = strtok(NULL, delim);
-					address = atol(param);
-					free_block(arena, address);
-					break;
+	input_init(&in, stdin);
 
-				case 5:	 // READ
-					param = strtok(NULL, delim);
-					address = atol(param);
-					param = strtok(NULL, delim);
-					size = atol(param);
-					read(arena, address, size);
-					break;
+	// READ sends its bytes out in big runs, so when the output doesn't go to a
+	// terminal it is only flushed once a big buffer fills.
+	if (!stdout_is_terminal())
+		setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
 
-				case 6:	 // WRITE
-					param = strtok(NULL, delim);
-					address = atol(param);
-					param = strtok(NULL, delim);
-					size = atol(param);
-					int8_t *data = (int8_t *)create_string(size);
-					write(arena, address, size, data);
-					break;
+	if (binary) {
+		run_binary(&in, &arenas, stdout);
+		close_metrics_dump();
+		pool_destroy_all();
+		input_destroy(&in);
+		return 0;
+	}
 
-				case 7:	 // PMAP
-					pmap(arena);
-					break;
+	if (pipelined) {
+		run_pipeline(&arenas, &in, stdout);
+	} else {
+		while ((line = input_line(&in, &line_len))) {
+			if (line[0] == '\0')
+				continue;
 
-				case 8:	 // MPROTECT
-					param = strtok(NULL, delim);
-					address = atol(param);
-					param = strtok(NULL, "\n");
-					int8_t *permission = (int8_t *)param;
-					mprotect(arena, address, permission);
-					break;
-			}
+			// The words are only pointed at, in the buffer of the reader.
+			parse_command(line, line_len, &cmd);
+			if (run_command(&arenas, &cmd, &in, line, line_len, stdout))
+				break;
+		}
 	}
+	destroy_all_arenas(&arenas);
+	close_metrics_dump();
+	pool_destroy_all();
+	input_destroy(&in);
 	return 0;
 }
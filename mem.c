@@ -0,0 +1,148 @@
+// Similea Alin-Andrei 314CA
+#define _DEFAULT_SOURCE	 // the MAP_* flags, madvise, fileno, fdopen
+#include "mem.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+// Reserves a zeroed range of addresses. The system only gives it physical
+// pages when they are written, so even huge ranges are cheap. Returns NULL if
+// the range doesn't fit in the address space.
+void *mem_reserve(uint64_t size)
+{
+	void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	return addr == MAP_FAILED ? NULL : addr;
+}
+
+// Gives back a range obtained through mem_reserve.
+void mem_release(void *addr, uint64_t size)
+{
+	munmap(addr, size);
+}
+
+// Drops the physical pages of a page-aligned range: it reads as zeroes again.
+void mem_discard(void *addr, uint64_t size)
+{
+	madvise(addr, size, MADV_DONTNEED);
+}
+
+// Puts new zeroed pages in place of a page-aligned range. Unlike
+// "mem_discard", it also zeroes the pages mapped from a file, which would
+// otherwise read as the file again. Returns 0 if it failed(the range is left
+// as it was).
+int mem_zero(void *addr, uint64_t size)
+{
+	void *new_addr = mmap(addr, size, PROT_READ | PROT_WRITE,
+						  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE |
+						  MAP_FIXED, -1, 0);
+
+	return new_addr != MAP_FAILED;
+}
+
+// Maps "size" bytes of a file, from a page-aligned offset, over a range
+// obtained through mem_reserve. The pages are only read from the file when
+// they are touched and the changes stay private. Returns 0 if it failed.
+int mem_map_file(void *addr, uint64_t size, FILE *file, uint64_t offset)
+{
+	void *new_addr = mmap(addr, size, PROT_READ | PROT_WRITE,
+						  MAP_PRIVATE | MAP_FIXED, fileno(file), offset);
+
+	return new_addr != MAP_FAILED;
+}
+
+// Reads "size" bytes of a file, from "offset", into memory. It doesn't use the
+// position of the stream. Returns 0 if the file ends before them.
+int mem_read_file(void *addr, uint64_t size, FILE *file, uint64_t offset)
+{
+	uint8_t *dest = addr;
+
+	while (size) {
+		ssize_t nr_read = pread(fileno(file), dest, size, offset);
+		if (nr_read <= 0)
+			return 0;
+		dest += nr_read;
+		offset += nr_read;
+		size -= nr_read;
+	}
+	return 1;
+}
+
+// Number of bytes of an open file.
+uint64_t file_size(FILE *file)
+{
+	struct stat st;
+
+	if (fstat(fileno(file), &st) < 0)
+		return 0;
+	return st.st_size;
+}
+
+// Makes a pipe and returns a stream that writes into it. The bytes come out of
+// "*read_end", through "pipe_read". Returns NULL if there are no descriptors
+// left.
+FILE *pipe_open(int *read_end)
+{
+	int ends[2];
+
+	if (pipe(ends) < 0)
+		return NULL;
+
+	FILE *stream = fdopen(ends[1], "w");
+	if (!stream) {
+		close(ends[0]);
+		close(ends[1]);
+		return NULL;
+	}
+	*read_end = ends[0];
+	return stream;
+}
+
+// Reads what the pipe has, at most "size" bytes, waiting only if it is empty.
+// Returns 0 once the stream that writes into it was closed.
+size_t pipe_read(int read_end, void *buf, size_t size)
+{
+	struct iovec iov = {buf, size};
+	ssize_t nr_read;
+
+	// readv, since the "read" of the program is the command of the arenas.
+	do
+		nr_read = readv(read_end, &iov, 1);
+	while (nr_read < 0 && errno == EINTR);
+	return nr_read > 0 ? (size_t)nr_read : 0;
+}
+
+void pipe_close(int read_end)
+{
+	close(read_end);
+}
+
+// Tells whether the standard output goes to a terminal (and not to a file or a
+// pipe).
+int stdout_is_terminal(void)
+{
+	return isatty(fileno(stdout));
+}
+
+// The time of the monotonic clock, in ns(read without entering the kernel).
+uint64_t monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Number of processors online.
+int nr_processors(void)
+{
+	long nr = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return nr > 0 ? (int)nr : 1;
+}
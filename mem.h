@@ -0,0 +1,28 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Wrappers over the system calls that manage the bytes of an arena. They live
+// in their own file because <sys/mman.h> and <unistd.h> declare an "mprotect",
+// a "read" and a "write" of their own.
+
+// ===== Virtual memory functions =====
+void *mem_reserve(uint64_t size);
+void mem_release(void *addr, uint64_t size);
+void mem_discard(void *addr, uint64_t size);
+int mem_zero(void *addr, uint64_t size);
+int mem_map_file(void *addr, uint64_t size, FILE *file, uint64_t offset);
+int mem_read_file(void *addr, uint64_t size, FILE *file, uint64_t offset);
+
+// ===== File functions =====
+uint64_t file_size(FILE *file);
+FILE *pipe_open(int *read_end);
+size_t pipe_read(int read_end, void *buf, size_t size);
+void pipe_close(int read_end);
+
+// ===== Other system functions =====
+int stdout_is_terminal(void);
+int nr_processors(void);
+uint64_t monotonic_ns(void);
@@ -0,0 +1,173 @@
+// Similea Alin-Andrei 314CA
+#include "metrics.h"
+
+#include "mem.h"
+#include "vma.h"
+
+static const char *const command_names[METRICS_NR_COMMANDS] = {
+	"INVALID", "ALLOC_ARENA", "DEALLOC_ARENA", "ALLOC_BLOCK", "FREE_BLOCK",
+	"READ", "WRITE", "PMAP", "MPROTECT", "ALLOC_AUTO", "STATS", "SAVE", "LOAD",
+	"MEMSET", "MEMCPY", "MEMMOVE", "MEMCMP", "READV", "WRITEV"
+};
+
+static const char *const status_names[VMA_NR_STATUSES] = {
+	[VMA_OK] = "OK",
+	[VMA_NO_ARENA] = "NO_ARENA",
+	[VMA_ADDRESS_OUTSIDE] = "ADDRESS_OUTSIDE",
+	[VMA_END_OUTSIDE] = "END_OUTSIDE",
+	[VMA_ZONE_ALLOCATED] = "ZONE_ALLOCATED",
+	[VMA_INVALID_FREE] = "INVALID_FREE",
+	[VMA_INVALID_READ] = "INVALID_READ",
+	[VMA_PERM_READ] = "PERM_READ",
+	[VMA_INVALID_WRITE] = "INVALID_WRITE",
+	[VMA_PERM_WRITE] = "PERM_WRITE",
+	[VMA_INVALID_MPROTECT] = "INVALID_MPROTECT",
+	[VMA_INVALID_COMMAND] = "INVALID_COMMAND",
+	[VMA_INVALID_HANDLE] = "INVALID_HANDLE",
+	[VMA_INVALID_SIZE] = "INVALID_SIZE",
+	[VMA_INVALID_ALIGNMENT] = "INVALID_ALIGNMENT",
+	[VMA_NO_FIT] = "NO_FIT",
+	[VMA_INVALID_ENGINE] = "INVALID_ENGINE",
+	[VMA_FILE_ERROR] = "FILE_ERROR",
+	[VMA_INVALID_CHECKPOINT] = "INVALID_CHECKPOINT",
+	[VMA_OVERLAP] = "OVERLAP",
+};
+
+// Where DEALLOC_ARENA dumps the metrics(nowhere if NULL).
+static FILE *dump_file;
+
+// Opens the file the metrics are dumped to, one line at every DEALLOC_ARENA.
+// Returns 0 if it can't be opened.
+int open_metrics_dump(const char *path)
+{
+	dump_file = fopen(path, "a");
+	return dump_file != NULL;
+}
+
+void close_metrics_dump(void)
+{
+	if (dump_file)
+		fclose(dump_file);
+	dump_file = NULL;
+}
+
+#ifdef VMA_METRICS
+__thread metrics_t metrics;
+
+static int bucket_of(uint64_t ns)
+{
+	int bucket = 63 - __builtin_clzll(ns | 1);
+
+	return bucket < METRICS_NR_BUCKETS ? bucket : METRICS_NR_BUCKETS - 1;
+}
+
+// A command starts(an unknown one counts as INVALID).
+void metrics_begin(int command)
+{
+	metrics.command = command > 0 && command < METRICS_NR_COMMANDS ? command
+																	: 0;
+	metrics.failed = 0;
+	metrics.start_ns = monotonic_ns();
+}
+
+// The command got a result. Only its first error is counted.
+void metrics_status(int status)
+{
+	if (status & VMA_TRUNCATED)
+		metrics.truncated++;
+	status &= ~VMA_TRUNCATED;
+	if (status == VMA_OK || status >= VMA_NR_STATUSES || metrics.failed)
+		return;
+	metrics.failed = 1;
+	metrics.errors[status]++;
+	metrics.commands[metrics.command].errors++;
+}
+
+// The command ended.
+void metrics_end(void)
+{
+	uint64_t ns = monotonic_ns() - metrics.start_ns;
+	command_metrics_t *command = &metrics.commands[metrics.command];
+
+	command->calls++;
+	command->total_ns += ns;
+	command->buckets[bucket_of(ns)]++;
+}
+
+// Prints the metrics for STATS -c: the commands that ran, each with its
+// non-empty latency buckets, then the errors and the other counters.
+void print_metrics(FILE *out)
+{
+	for (int i = 0; i < METRICS_NR_COMMANDS; i++) {
+		command_metrics_t *command = &metrics.commands[i];
+		if (!command->calls)
+			continue;
+		fprintf(out, "Command %s: %lu calls, %lu errors, %lu ns\n",
+				command_names[i], command->calls, command->errors,
+				command->total_ns);
+		for (int j = 0; j < METRICS_NR_BUCKETS; j++)
+			if (command->buckets[j])
+				fprintf(out, "\t[%lu, %lu) ns: %lu\n", 1UL << j, 2UL << j,
+						command->buckets[j]);
+	}
+	for (int i = 1; i < VMA_NR_STATUSES; i++)
+		if (metrics.errors[i])
+			fprintf(out, "Error %s: %lu\n", status_names[i],
+					metrics.errors[i]);
+	fprintf(out, "Truncated: %lu\n", metrics.truncated);
+	fprintf(out, "Bytes read: %lu\n", metrics.bytes_read);
+	fprintf(out, "Bytes written: %lu\n", metrics.bytes_written);
+	fprintf(out, "Block lookups: %lu, %lu steps\n", metrics.block_lookups,
+			metrics.block_steps);
+	fprintf(out, "Miniblock lookups: %lu, %lu steps\n", metrics.minib_lookups,
+			metrics.minib_steps);
+}
+
+// Writes the metrics as a line of JSON to the dump file, if there is one.
+void dump_metrics(void)
+{
+	if (!dump_file)
+		return;
+
+	fprintf(dump_file, "{\"commands\": {");
+	for (int i = 0, first = 1; i < METRICS_NR_COMMANDS; i++) {
+		command_metrics_t *command = &metrics.commands[i];
+		if (!command->calls)
+			continue;
+		fprintf(dump_file, "%s\"%s\": {\"calls\": %lu, \"errors\": %lu, "
+				"\"total_ns\": %lu, \"buckets\": [", first ? "" : ", ",
+				command_names[i], command->calls, command->errors,
+				command->total_ns);
+		for (int j = 0; j < METRICS_NR_BUCKETS; j++)
+			fprintf(dump_file, "%s%lu", j ? ", " : "", command->buckets[j]);
+		fprintf(dump_file, "]}");
+		first = 0;
+	}
+	fprintf(dump_file, "}, \"errors\": {");
+	for (int i = 1, first = 1; i < VMA_NR_STATUSES; i++) {
+		if (!metrics.errors[i])
+			continue;
+		fprintf(dump_file, "%s\"%s\": %lu", first ? "" : ", ",
+				status_names[i], metrics.errors[i]);
+		first = 0;
+	}
+	fprintf(dump_file, "}, \"truncated\": %lu, \"bytes_read\": %lu, "
+			"\"bytes_written\": %lu, \"block_lookups\": %lu, "
+			"\"block_steps\": %lu, \"minib_lookups\": %lu, "
+			"\"minib_steps\": %lu}\n", metrics.truncated, metrics.bytes_read,
+			metrics.bytes_written, metrics.block_lookups, metrics.block_steps,
+			metrics.minib_lookups, metrics.minib_steps);
+	fflush(dump_file);
+}
+#else
+void print_metrics(FILE *out)
+{
+	fprintf(out, "Metrics are not built in.\n");
+}
+
+void dump_metrics(void)
+{
+	(void)command_names;
+	(void)status_names;
+}
+#endif
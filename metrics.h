@@ -0,0 +1,78 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "vma.h"
+
+// Counters of the commands run so far: the calls, errors and latencies of each
+// command, the errors by reason, the bytes read and written and the nodes
+// visited to find blocks and miniblocks. Each thread keeps its own(the
+// drivers only have one), so counting never takes a lock. The latencies come
+// from the monotonic clock and go in buckets of powers of two: bucket i holds
+// the commands that took [2^i, 2^(i+1)) ns.
+// They are built in unless compiled with VMA_NO_METRICS("make METRICS=0"):
+// then the functions called on every command are empty and inlined away.
+#ifndef VMA_NO_METRICS
+#define VMA_METRICS
+#endif
+
+#define METRICS_NR_COMMANDS 19	// the numbers given by "command_type"
+#define METRICS_NR_BUCKETS 40
+
+typedef struct {
+	uint64_t calls;
+	uint64_t errors;
+	uint64_t total_ns;
+	uint64_t buckets[METRICS_NR_BUCKETS];
+} command_metrics_t;
+
+typedef struct {
+	command_metrics_t commands[METRICS_NR_COMMANDS];
+	uint64_t errors[VMA_NR_STATUSES];  // by reason, VMA_OK unused
+	uint64_t truncated;	 // zones cut to the end of the block
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+	uint64_t block_lookups;
+	uint64_t block_steps;  // tree nodes visited by the lookups
+	uint64_t minib_lookups;
+	uint64_t minib_steps;  // tree nodes and list nodes visited
+	int command;  // the one running now
+	int failed;	 // whether it already counted an error
+	uint64_t start_ns;
+} metrics_t;
+
+#ifdef VMA_METRICS
+extern __thread metrics_t metrics;
+// The nodes visited by the AVL searches of this thread("avl.c").
+extern __thread uint64_t avl_steps;
+#define METRICS_ADD(counter, n) ((counter) += (n))
+#define METRICS_STEPS() avl_steps
+
+// ===== Metrics functions =====
+void metrics_begin(int command);
+void metrics_status(int status);
+void metrics_end(void);
+#else
+#define METRICS_ADD(counter, n) ((void)(n))
+#define METRICS_STEPS() 0
+
+static inline void metrics_begin(int command)
+{
+	(void)command;
+}
+
+static inline void metrics_status(int status)
+{
+	(void)status;
+}
+
+static inline void metrics_end(void)
+{
+}
+#endif
+
+void print_metrics(FILE *out);
+int open_metrics_dump(const char *path);
+void dump_metrics(void);
+void close_metrics_dump(void);
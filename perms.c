@@ -0,0 +1,112 @@
+// Similea Alin-Andrei 314CA
+#include "perms.h"
+
+// Number of bytes of the permission table for an arena of given size.
+uint64_t perm_table_size(uint64_t arena_size)
+{
+	return (arena_size + VMA_PAGE_SIZE - 1) / VMA_PAGE_SIZE;
+}
+
+// Tells whether any miniblock has bytes on the given page.
+static int page_used(arena_t *arena, uint64_t page)
+{
+	uint64_t last = (page + 1) * VMA_PAGE_SIZE - 1;
+	avl_node_t *entry = avl_floor(arena->minib_index, last);
+
+	if (!entry)
+		return 0;
+	miniblock_t *minib = (miniblock_t *)(*(node_t **)entry->data)->data;
+	return minib->start_address + minib->size > page * VMA_PAGE_SIZE;
+}
+
+// Finds the byte of a page from the miniblocks on it. The walk stops at the
+// first two miniblocks that don't agree.
+static uint8_t page_entry(arena_t *arena, uint64_t page)
+{
+	uint64_t start = page * VMA_PAGE_SIZE, end = start + VMA_PAGE_SIZE;
+	avl_node_t *entry = avl_floor(arena->minib_index, start);
+	int perm = -1;
+
+	if (!entry)
+		entry = avl_first(arena->minib_index);
+	for (; entry && entry->key < end; entry = avl_next(entry)) {
+		miniblock_t *minib = (miniblock_t *)(*(node_t **)entry->data)->data;
+		if (minib->start_address + minib->size <= start)
+			continue;
+		if (perm >= 0 && perm != minib->perm)
+			return PERM_MIXED;
+		perm = minib->perm;
+	}
+	return perm < 0 ? 0 : perm ^ VMA_DEFAULT_PERM;
+}
+
+// A new miniblock(with the default permissions) was placed at the given zone.
+// Its whole pages were free, so they already hold 0, and a page it shares
+// with other miniblocks stays right unless they have other permissions.
+void perms_allocated(arena_t *arena, uint64_t address, uint64_t size)
+{
+	uint64_t first = address / VMA_PAGE_SIZE;
+	uint64_t last = (address + size - 1) / VMA_PAGE_SIZE;
+
+	if (arena->page_perms[first])
+		arena->page_perms[first] = PERM_MIXED;
+	if (arena->page_perms[last])
+		arena->page_perms[last] = PERM_MIXED;
+}
+
+// The miniblock at the given zone was freed. The pages left without
+// miniblocks go back to 0, the others keep their byte: a page that was right
+// stays right with less miniblocks on it.
+void perms_freed(arena_t *arena, uint64_t address, uint64_t size)
+{
+	uint64_t first = address / VMA_PAGE_SIZE;
+	uint64_t last = (address + size - 1) / VMA_PAGE_SIZE;
+
+	if (last > first + 1)
+		memset(arena->page_perms + first + 1, 0, last - first - 1);
+	if (!page_used(arena, first))
+		arena->page_perms[first] = 0;
+	if (!page_used(arena, last))
+		arena->page_perms[last] = 0;
+}
+
+// All the miniblocks of the given zone got the permissions "perm".
+void perms_changed(arena_t *arena, uint64_t address, uint64_t size,
+				   uint8_t perm)
+{
+	uint64_t first = address / VMA_PAGE_SIZE;
+	uint64_t last = (address + size - 1) / VMA_PAGE_SIZE;
+
+	if (last > first + 1)
+		memset(arena->page_perms + first + 1, perm ^ VMA_DEFAULT_PERM,
+			   last - first - 1);
+	arena->page_perms[first] = page_entry(arena, first);
+	arena->page_perms[last] = page_entry(arena, last);
+}
+
+// Verifies whether all the "size" bytes from the given address(all of them
+// allocated) have the permission "mode"(4 -> READ, 2 -> WRITE): a lookup for
+// each page, and a look at the miniblocks only for the pages where they don't
+// agree. Even with no bytes, the byte at the address is checked.
+int perms_check(arena_t *arena, uint64_t address, uint64_t size, int mode)
+{
+	uint64_t end = address + (size ? size : 1);
+
+	while (address < end) {
+		uint64_t page = address / VMA_PAGE_SIZE;
+		uint64_t page_end = (page + 1) * VMA_PAGE_SIZE;
+		if (page_end > end)
+			page_end = end;
+
+		uint8_t entry = arena->page_perms[page];
+		if (entry == PERM_MIXED) {
+			if (!check_permission(find_miniblock(arena, address), address,
+								  page_end - address, mode))
+				return 0;
+		} else if (!((entry ^ VMA_DEFAULT_PERM) & mode)) {
+			return 0;
+		}
+		address = page_end;
+	}
+	return 1;
+}
@@ -0,0 +1,21 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+#include "vma.h"
+
+// The permissions of an arena, page by page: a byte for each page, reserved
+// like the bitmap of written pages, so the pages never allocated cost nothing.
+// A byte holds the permissions of all the miniblocks on its page, XOR-ed with
+// the default ones(so a new block doesn't have to fill its pages), or
+// PERM_MIXED when they don't agree: only those pages need a look at the
+// miniblocks themselves. A page with no miniblock on it always holds 0.
+#define PERM_MIXED 0x80
+
+// ===== Permission table functions =====
+uint64_t perm_table_size(uint64_t arena_size);
+void perms_allocated(arena_t *arena, uint64_t address, uint64_t size);
+void perms_freed(arena_t *arena, uint64_t address, uint64_t size);
+void perms_changed(arena_t *arena, uint64_t address, uint64_t size,
+				   uint8_t perm);
+int perms_check(arena_t *arena, uint64_t address, uint64_t size, int mode);
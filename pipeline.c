@@ -0,0 +1,225 @@
+// Similea Alin-Andrei 314CA
+#include "pipeline.h"
+
+#include <pthread.h>
+
+#include "driver.h"
+#include "mem.h"
+
+static size_t align_job(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+// Makes room for "size" more bytes at the end of the batch.
+static void reserve(batch_t *batch, uint64_t size)
+{
+	if (batch->size + size <= batch->capacity)
+		return;
+
+	batch->capacity *= 2;
+	if (batch->capacity < batch->size + size)
+		batch->capacity = batch->size + size;
+	batch->data = realloc(batch->data, batch->capacity);
+	DIE(!batch->data, "realloc failed");
+}
+
+// Takes an empty batch, back from the executor. A batch that grew for a big
+// WRITE goes back to its usual size.
+static batch_t *next_batch(pipeline_t *pipe)
+{
+	batch_t *batch = ring_pop(&pipe->free_batches);
+
+	if (batch->capacity > PIPELINE_BATCH_SIZE) {
+		free(batch->data);
+		batch->capacity = PIPELINE_BATCH_SIZE;
+		batch->data = malloc(batch->capacity);
+		DIE(!batch->data, "malloc failed");
+	}
+	batch->size = 0;
+	batch->last = 0;
+	return batch;
+}
+
+// Adds a command to the batch, with a copy of its line and its data, read from
+// the input in pieces(the input can end before the data does).
+static void add_job(batch_t *batch, command_t *cmd, input_t *in, char *line,
+					size_t line_len)
+{
+	uint64_t payload_len = command_payload(cmd, line, line_len), done = 0;
+	size_t start = batch->size;
+
+	reserve(batch, sizeof(job_t) + line_len + 1);
+	job_t *job = (job_t *)(batch->data + start);
+	job->cmd = *cmd;
+	for (int i = 0; i < cmd->nr_param && i < MAX_WORDS; i++)
+		job->word_pos[i] = cmd->word[i] - line;
+	job->line_len = line_len;
+	memcpy(job + 1, line, line_len + 1);
+	batch->size += sizeof(job_t) + line_len + 1;
+
+	while (done < payload_len) {
+		uint64_t piece = payload_len - done < PIPELINE_BATCH_SIZE ?
+						 payload_len - done : PIPELINE_BATCH_SIZE;
+		reserve(batch, piece);
+		uint64_t nr_read = input_read(in, batch->data + batch->size, piece);
+		batch->size += nr_read;
+		done += nr_read;
+		if (nr_read < piece)
+			break;
+	}
+
+	job = (job_t *)(batch->data + start);
+	job->payload_len = done;
+	batch->size = align_job(batch->size);
+}
+
+// The parser: splits the input into commands and sends them to the executor
+// in batches. It stops after the command that ends the program, so it never
+// reads more of the input than the serial driver.
+static void *parse_stage(void *arg)
+{
+	pipeline_t *pipe = arg;
+	batch_t *batch = next_batch(pipe);
+	input_t *in = pipe->in;
+	command_t cmd;
+	size_t line_len;
+	char *line;
+
+	while (1) {
+		// The reader is about to wait for more input, so the commands
+		// read until now can't wait for the batch to fill.
+		if (in->pos == in->end && batch->size) {
+			ring_push(&pipe->batches, batch);
+			batch = next_batch(pipe);
+		}
+
+		line = input_line(in, &line_len);
+		if (!line)
+			break;
+		if (line[0] == '\0')
+			continue;
+
+		parse_command(line, line_len, &cmd);
+		add_job(batch, &cmd, in, line, line_len);
+		if (command_ends(&cmd))
+			break;
+
+		if (batch->size >= PIPELINE_BATCH_SIZE) {
+			ring_push(&pipe->batches, batch);
+			batch = next_batch(pipe);
+		}
+	}
+
+	batch->last = 1;
+	ring_push(&pipe->batches, batch);
+	return NULL;
+}
+
+// Runs the commands of a batch, each one reading its data from its copy.
+static void run_batch(pipeline_t *pipe, batch_t *batch)
+{
+	size_t pos = 0;
+	input_t data;
+
+	while (pos < batch->size) {
+		job_t *job = (job_t *)(batch->data + pos);
+		char *line = (char *)(job + 1);
+		char *payload = line + job->line_len + 1;
+		command_t cmd = job->cmd;
+
+		for (int i = 0; i < cmd.nr_param && i < MAX_WORDS; i++)
+			cmd.word[i] = line + job->word_pos[i];
+		input_init_bytes(&data, payload, job->payload_len);
+		run_command(pipe->arenas, &cmd, &data, line, job->line_len,
+					pipe->results);
+		pos = align_job(payload + job->payload_len - batch->data);
+	}
+}
+
+// The writer: sends what the executor printed to the output, in order.
+static void *write_stage(void *arg)
+{
+	pipeline_t *pipe = arg;
+	char *buf = malloc(PIPELINE_CHUNK_SIZE);
+	size_t size;
+
+	DIE(!buf, "malloc failed");
+	while ((size = pipe_read(pipe->read_end, buf, PIPELINE_CHUNK_SIZE))) {
+		fwrite(buf, 1, size, pipe->out);
+
+		// The pipe had less than a full chunk: what was written goes out.
+		if (size < PIPELINE_CHUNK_SIZE)
+			fflush(pipe->out);
+	}
+	fflush(pipe->out);
+	free(buf);
+	return NULL;
+}
+
+static void pipeline_init(pipeline_t *pipe, arena_table_t *arenas,
+						  input_t *in, FILE *out)
+{
+	pipe->arenas = arenas;
+	pipe->in = in;
+	pipe->out = out;
+	pipe->results = pipe_open(&pipe->read_end);
+	DIE(!pipe->results, "pipe_open failed");
+	setvbuf(pipe->results, NULL, _IOFBF, PIPELINE_CHUNK_SIZE);
+	ring_init(&pipe->batches, PIPELINE_NR_BATCHES);
+	ring_init(&pipe->free_batches, PIPELINE_NR_BATCHES);
+
+	for (int i = 0; i < PIPELINE_NR_BATCHES; i++) {
+		batch_t *batch = malloc(sizeof(*batch));
+		DIE(!batch, "malloc failed");
+		batch->capacity = PIPELINE_BATCH_SIZE;
+		batch->data = malloc(batch->capacity);
+		DIE(!batch->data, "malloc failed");
+		ring_push(&pipe->free_batches, batch);
+	}
+}
+
+// Frees the batches, all back on their free ring once the threads are done.
+static void pipeline_destroy(pipeline_t *pipe)
+{
+	for (int i = 0; i < PIPELINE_NR_BATCHES; i++) {
+		batch_t *batch = ring_pop(&pipe->free_batches);
+		free(batch->data);
+		free(batch);
+	}
+	ring_destroy(&pipe->batches);
+	ring_destroy(&pipe->free_batches);
+	pipe_close(pipe->read_end);
+}
+
+// Runs the commands of the input like the serial text driver, printing to
+// "out", with the parser and the writer on their own threads. The calling
+// thread is the executor.
+void run_pipeline(arena_table_t *arenas, input_t *in, FILE *out)
+{
+	pthread_t parser, writer;
+	pipeline_t pipe;
+	int last = 0;
+
+	pipeline_init(&pipe, arenas, in, out);
+	DIE(pthread_create(&parser, NULL, parse_stage, &pipe) ||
+		pthread_create(&writer, NULL, write_stage, &pipe),
+		"pthread_create failed");
+
+	while (!last) {
+		batch_t *batch = ring_pop(&pipe.batches);
+		run_batch(&pipe, batch);
+		last = batch->last;
+		ring_push(&pipe.free_batches, batch);
+
+		// No commands are ready yet: the output so far goes out.
+		if (ring_empty(&pipe.batches))
+			fflush(pipe.results);
+	}
+
+	// Closing the pipe tells the writer that the output ends.
+	fclose(pipe.results);
+	pthread_join(parser, NULL);
+	pthread_join(writer, NULL);
+	pipeline_destroy(&pipe);
+}
@@ -0,0 +1,51 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "input.h"
+#include "ring.h"
+#include "vma.h"
+
+// Pipelined text driver: the commands go through three threads, connected by
+// rings("ring.h"). The parser reads the lines, splits them into words and
+// copies each one, with the data of the command that comes after it, into a
+// batch of jobs. The executor runs the jobs of each batch in order, with the
+// same code as the serial driver, and prints into a pipe that the writer
+// empties into the output, a chunk at a time. Each batch goes back to the
+// parser on a second ring, so they are allocated once.
+// The output is the same as the one of the serial driver, byte for byte: the
+// commands run one after another and the pipe keeps their order.
+#define PIPELINE_BATCH_SIZE (256 << 10)	 // a batch is sent once this full
+#define PIPELINE_NR_BATCHES 8
+#define PIPELINE_CHUNK_SIZE (64 << 10)	 // what the executor buffers, at most
+
+// A command in a batch, followed by a copy of its line(with the terminator)
+// and by its data, padded to 8 bytes.
+typedef struct {
+	command_t cmd;	// its words point into the buffer of the reader
+	uint32_t word_pos[MAX_WORDS];  // where the words are in the copy
+	size_t line_len;
+	uint64_t payload_len;  // the bytes of data, fewer if the input ended
+} job_t;
+
+typedef struct {
+	char *data;	 // the jobs, one after another
+	size_t size;
+	size_t capacity;
+	int last;  // no batch comes after this one
+} batch_t;
+
+typedef struct {
+	arena_table_t *arenas;
+	input_t *in;
+	FILE *out;	// where the writer sends the results
+	FILE *results;	// the executor prints here, into the pipe
+	int read_end;  // the writer reads the pipe here
+	ring_t batches;	 // parser -> executor
+	ring_t free_batches;  // executor -> parser
+} pipeline_t;
+
+// ===== Pipelined driver functions =====
+void run_pipeline(arena_table_t *arenas, input_t *in, FILE *out);
@@ -0,0 +1,141 @@
+// Similea Alin-Andrei 314CA
+#define _POSIX_C_SOURCE 200809L	 // pthread_mutex_t
+#include "pool.h"
+
+#include <pthread.h>
+
+#include "vma.h"
+
+#define POOL_SLAB_SIZE 65536
+#define POOL_MAX_SIZES 16
+
+// One pool for every object size in use, shared by all the lists and trees.
+static pool_t pools[POOL_MAX_SIZES];
+static unsigned int nr_pools;
+
+// Once an arena is concurrent, the pools are used from more than one thread,
+// so every call takes the mutex.
+static int pool_locking;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void pool_lock(void)
+{
+	if (pool_locking)
+		pthread_mutex_lock(&pool_mutex);
+}
+
+static void pool_unlock(void)
+{
+	if (pool_locking)
+		pthread_mutex_unlock(&pool_mutex);
+}
+
+// Makes the pools safe to use from more than one thread. It must be called
+// before the other threads start.
+void pool_enable_locking(void)
+{
+	pool_locking = 1;
+}
+
+// Returns the pool that serves objects of the given size, creating it on the
+// first request.
+pool_t *pool_get(size_t obj_size)
+{
+	// Every object must be able to hold the free list link and keep the
+	// alignment of the objects after it in the slab.
+	obj_size = (obj_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	if (obj_size < sizeof(void *))
+		obj_size = sizeof(void *);
+
+	pool_lock();
+	for (unsigned int i = 0; i < nr_pools; i++) {
+		if (pools[i].obj_size == obj_size) {
+			pool_unlock();
+			return &pools[i];
+		}
+	}
+
+	DIE(nr_pools == POOL_MAX_SIZES, "too many pool sizes");
+	pool_t *pool = &pools[nr_pools++];
+	pool->obj_size = obj_size;
+	pool->objs_per_slab = (POOL_SLAB_SIZE - sizeof(void *)) / obj_size;
+	if (pool->objs_per_slab == 0)
+		pool->objs_per_slab = 1;
+	pool->free_list = NULL;
+	pool->slabs = NULL;
+	pool->nr_allocs = 0;
+	pool->nr_slabs = 0;
+	pool_unlock();
+
+	return pool;
+}
+
+// Allocates a new slab and puts all of its objects in the free list.
+static void pool_grow(pool_t *pool)
+{
+	char *slab = malloc(sizeof(void *) + pool->objs_per_slab * pool->obj_size);
+	DIE(!slab, "malloc failed");
+	*(void **)slab = pool->slabs;
+	pool->slabs = slab;
+	pool->nr_slabs++;
+
+	char *obj = slab + sizeof(void *);
+	for (unsigned int i = 0; i < pool->objs_per_slab; i++) {
+		*(void **)obj = pool->free_list;
+		pool->free_list = obj;
+		obj += pool->obj_size;
+	}
+}
+
+// Returns an (uninitialized) object from the pool.
+void *pool_alloc(pool_t *pool)
+{
+	pool_lock();
+	if (!pool->free_list)
+		pool_grow(pool);
+
+	void *obj = pool->free_list;
+	pool->free_list = *(void **)obj;
+	pool->nr_allocs++;
+	pool_unlock();
+
+	return obj;
+}
+
+// Gives the object back to its pool.
+void pool_free(pool_t *pool, void *obj)
+{
+	if (!obj)
+		return;
+
+	pool_lock();
+	*(void **)obj = pool->free_list;
+	pool->free_list = obj;
+	pool_unlock();
+}
+
+// Total number of objects handed out and of slabs requested from the system
+// allocator by all the pools.
+void pool_stats(uint64_t *nr_allocs, uint64_t *nr_slabs)
+{
+	*nr_allocs = 0;
+	*nr_slabs = 0;
+	for (unsigned int i = 0; i < nr_pools; i++) {
+		*nr_allocs += pools[i].nr_allocs;
+		*nr_slabs += pools[i].nr_slabs;
+	}
+}
+
+// Gives all the slabs back to the system allocator. Every object handed out
+// by the pools becomes invalid.
+void pool_destroy_all(void)
+{
+	for (unsigned int i = 0; i < nr_pools; i++) {
+		while (pools[i].slabs) {
+			void *next = *(void **)pools[i].slabs;
+			free(pools[i].slabs);
+			pools[i].slabs = next;
+		}
+	}
+	nr_pools = 0;
+}
@@ -0,0 +1,26 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Fixed-size object allocator: objects are carved out of big slabs and the
+// freed ones are kept in a free list, so the system allocator is only called
+// once per slab.
+typedef struct {
+	size_t obj_size;
+	unsigned int objs_per_slab;
+	void *free_list;  // linked through the first word of each free object
+	void *slabs;	  // linked through the first word of each slab
+	uint64_t nr_allocs;
+	uint64_t nr_slabs;
+} pool_t;
+
+// ===== Pool functions =====
+pool_t *pool_get(size_t obj_size);
+void *pool_alloc(pool_t *pool);
+void pool_free(pool_t *pool, void *obj);
+void pool_stats(uint64_t *nr_allocs, uint64_t *nr_slabs);
+void pool_destroy_all(void);
+void pool_enable_locking(void);
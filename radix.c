@@ -0,0 +1,169 @@
+// Similea Alin-Andrei 314CA
+#include "radix.h"
+
+#include "vma.h"
+
+// The size of a table of the given level: pointers to the tables of the next
+// level, or leaves for the last one.
+static size_t table_size(int level)
+{
+	if (level == RADIX_LEVELS - 1)
+		return RADIX_FANOUT * sizeof(radix_leaf_t);
+	return RADIX_FANOUT * sizeof(void *);
+}
+
+radix_t *radix_create(void)
+{
+	radix_t *radix = pool_alloc(pool_get(sizeof(*radix)));
+
+	radix->root = NULL;
+	radix->nr_tables = 0;
+	return radix;
+}
+
+static void free_table(void *table, int level)
+{
+	if (level < RADIX_LEVELS - 1)
+		for (unsigned int i = 0; i < RADIX_FANOUT; i++)
+			if (((void **)table)[i])
+				free_table(((void **)table)[i], level + 1);
+	pool_free(pool_get(table_size(level)), table);
+}
+
+void radix_destroy(radix_t *radix)
+{
+	if (!radix)
+		return;
+	if (radix->root)
+		free_table(radix->root, 0);
+	pool_free(pool_get(sizeof(*radix)), radix);
+}
+
+// Walks the levels down to the leaf of a page. The missing tables are made if
+// "create" is set, otherwise there is no leaf(NULL).
+static radix_leaf_t *leaf_of(radix_t *radix, uint64_t page, int create)
+{
+	void **slot = &radix->root;
+
+	for (int level = 0; level < RADIX_LEVELS; level++) {
+		if (!*slot) {
+			if (!create)
+				return NULL;
+			*slot = pool_alloc(pool_get(table_size(level)));
+			memset(*slot, 0, table_size(level));
+			radix->nr_tables++;
+		}
+
+		int shift = RADIX_BITS * (RADIX_LEVELS - 1 - level);
+		unsigned int idx = (page >> shift) & (RADIX_FANOUT - 1);
+		if (level == RADIX_LEVELS - 1)
+			return (radix_leaf_t *)*slot + idx;
+		slot = (void **)*slot + idx;
+	}
+	return NULL;
+}
+
+static uint64_t start_of(node_t *minib)
+{
+	return ((miniblock_t *)minib->data)->start_address;
+}
+
+static uint64_t end_of(node_t *minib)
+{
+	return start_of(minib) + ((miniblock_t *)minib->data)->size;
+}
+
+// Moves to the miniblock right after the given one, in its block or at the
+// start of the next block. The miniblock is NULL if it was the last one.
+static void next_miniblock(avl_node_t **block, node_t **minib)
+{
+	if ((*minib)->next) {
+		*minib = (*minib)->next;
+		return;
+	}
+	*block = avl_next(*block);
+	*minib = *block ? ((list_t *)((block_t *)(*block)->data)->miniblock_list)
+						  ->head
+					: NULL;
+}
+
+// Returns the node of the miniblock holding the address(NULL if the address is
+// free) and gives the tree node of its block in "block". The miniblocks are
+// walked from the first one of the page, so at most the ones of the page are
+// looked at. The address must be inside the arena: the levels only use the low
+// 48 bits of it.
+node_t *radix_lookup(radix_t *radix, uint64_t address, avl_node_t **block)
+{
+	radix_leaf_t *leaf = leaf_of(radix, address / VMA_PAGE_SIZE, 0);
+	node_t *minib = leaf ? leaf->minib : NULL;
+
+	*block = leaf ? leaf->block : NULL;
+	while (minib && end_of(minib) <= address)
+		next_miniblock(block, &minib);
+	if (!minib || start_of(minib) > address) {
+		*block = NULL;
+		return NULL;
+	}
+	return minib;
+}
+
+// A new miniblock was put in the arena(or cut from the end of another one).
+// It is the first miniblock of all its pages, except of the first one if a
+// miniblock before it starts there.
+void radix_map(radix_t *radix, avl_node_t *block, node_t *minib)
+{
+	if (!radix)
+		return;
+
+	uint64_t start = start_of(minib), end = end_of(minib);
+	for (uint64_t page = start / VMA_PAGE_SIZE;
+		 page * VMA_PAGE_SIZE < end; page++) {
+		radix_leaf_t *leaf = leaf_of(radix, page, 1);
+		if (leaf->minib && start_of(leaf->minib) < start)
+			continue;
+		leaf->block = block;
+		leaf->minib = minib;
+	}
+}
+
+// The miniblock is being freed(it is still in its block). On the pages where
+// it was the first one, the miniblock after it takes its place if it starts
+// on the same page.
+void radix_unmap(radix_t *radix, avl_node_t *block, node_t *minib)
+{
+	if (!radix)
+		return;
+
+	uint64_t start = start_of(minib), end = end_of(minib);
+	avl_node_t *next_block = block;
+	node_t *next = minib;
+	next_miniblock(&next_block, &next);
+
+	for (uint64_t page = start / VMA_PAGE_SIZE;
+		 page * VMA_PAGE_SIZE < end; page++) {
+		radix_leaf_t *leaf = leaf_of(radix, page, 0);
+		if (!leaf || leaf->minib != minib)
+			continue;
+		int kept = next && start_of(next) < (page + 1) * VMA_PAGE_SIZE;
+		leaf->block = kept ? next_block : NULL;
+		leaf->minib = kept ? next : NULL;
+	}
+}
+
+// The miniblocks of the zone [address, address + size) moved to the block of
+// the given tree node(blocks were merged or split). The miniblocks themselves
+// didn't move, so only the block of the pages they come first on changes.
+void radix_rebind(radix_t *radix, uint64_t address, uint64_t size,
+				  avl_node_t *block)
+{
+	if (!radix)
+		return;
+
+	uint64_t end = address + size;
+	for (uint64_t page = address / VMA_PAGE_SIZE;
+		 page * VMA_PAGE_SIZE < end; page++) {
+		radix_leaf_t *leaf = leaf_of(radix, page, 0);
+		if (leaf && leaf->minib && start_of(leaf->minib) >= address)
+			leaf->block = block;
+	}
+}
@@ -0,0 +1,39 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+#include "avl.h"
+#include "list.h"
+
+// The page table of an arena that translates its addresses like x86-64 does:
+// 4 levels of 512 entries, indexed by 9 bits each of the page number, so
+// arenas of up to 2^48 bytes(more than can be reserved anyway). The tables are
+// only made for the pages that get mapped. The leaf of a page has the first
+// miniblock lying on it and the tree node of its block, or nothing if the page
+// is free. An address is found by walking the miniblocks from there, so it
+// only depends on the number of miniblocks sharing its page, not on the number
+// of blocks. The bytes of a page need no entry: they are always at
+// "base + address".
+#define RADIX_BITS 9
+#define RADIX_FANOUT (1U << RADIX_BITS)
+#define RADIX_LEVELS 4
+#define RADIX_MAX_SIZE (1ULL << 48)
+
+typedef struct {
+	avl_node_t *block;	// the node of the block in the tree of blocks
+	node_t *minib;	// the node of the miniblock in the list of its block
+} radix_leaf_t;
+
+typedef struct radix {
+	void *root;	 // the table of the first level
+	uint64_t nr_tables;
+} radix_t;
+
+// ===== Page table functions =====
+radix_t *radix_create(void);
+void radix_destroy(radix_t *radix);
+node_t *radix_lookup(radix_t *radix, uint64_t address, avl_node_t **block);
+void radix_map(radix_t *radix, avl_node_t *block, node_t *minib);
+void radix_unmap(radix_t *radix, avl_node_t *block, node_t *minib);
+void radix_rebind(radix_t *radix, uint64_t address, uint64_t size,
+				  avl_node_t *block);
@@ -0,0 +1,81 @@
+// Similea Alin-Andrei 314CA
+#define _POSIX_C_SOURCE 200809L	 // nanosleep and sched_yield
+#include "ring.h"
+
+#include <sched.h>
+#include <time.h>
+
+#include "vma.h"
+
+#define SPIN_ROUNDS 256
+#define YIELD_ROUNDS 64
+#define NAP_NS 50000
+
+// Initializes an empty ring, with room for "capacity" pointers(rounded up to a
+// power of 2).
+void ring_init(ring_t *ring, uint64_t capacity)
+{
+	ring->capacity = 1;
+	while (ring->capacity < capacity)
+		ring->capacity *= 2;
+	ring->slots = malloc(ring->capacity * sizeof(*ring->slots));
+	DIE(!ring->slots, "malloc failed");
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+// Frees the slots of the ring(not the items left in it).
+void ring_destroy(ring_t *ring)
+{
+	free(ring->slots);
+	ring->slots = NULL;
+}
+
+// Waits a bit longer each round: spins first, then yields, then naps.
+static void backoff(uint32_t *round)
+{
+	struct timespec nap = {0, NAP_NS};
+
+	if (*round < SPIN_ROUNDS)
+		__asm__ __volatile__("" ::: "memory");
+	else if (*round < SPIN_ROUNDS + YIELD_ROUNDS)
+		sched_yield();
+	else
+		nanosleep(&nap, NULL);
+	if (*round < SPIN_ROUNDS + YIELD_ROUNDS)
+		(*round)++;
+}
+
+// Adds an item at the end of the ring, waiting while the ring is full. Only
+// called by the producer.
+void ring_push(ring_t *ring, void *item)
+{
+	uint64_t tail = ring->tail;
+	uint32_t round = 0;
+
+	while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) ==
+		   ring->capacity)
+		backoff(&round);
+	ring->slots[tail & (ring->capacity - 1)] = item;
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Takes the item at the beginning of the ring, waiting while the ring is
+// empty. Only called by the consumer.
+void *ring_pop(ring_t *ring)
+{
+	uint64_t head = ring->head;
+	uint32_t round = 0;
+
+	while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head)
+		backoff(&round);
+	void *item = ring->slots[head & (ring->capacity - 1)];
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	return item;
+}
+
+// Whether the ring has no items right now. Only called by the consumer.
+int ring_empty(ring_t *ring)
+{
+	return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == ring->head;
+}
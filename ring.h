@@ -0,0 +1,29 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+// Bounded ring of pointers between two threads: one of them only pushes, the
+// other one only pops(single producer, single consumer). Each side writes its
+// own index and only reads the other one, so no lock is needed: a slot is
+// published by the release store of "tail" and given back by the release
+// store of "head". The indexes only grow, the slot of an index is
+// "index & (capacity - 1)". The indexes sit on separate cache lines, so the
+// two sides don't fight over a line while they work.
+// A side that has to wait(the ring is full or empty) spins for a while, then
+// yields the processor and at last sleeps in short naps, so a stage that has
+// nothing to do doesn't eat the time of the others.
+#define VMA_CACHE_LINE 64
+
+typedef struct {
+	void **slots;
+	uint64_t capacity;	// a power of 2
+	uint64_t head __attribute__((aligned(VMA_CACHE_LINE)));	 // the consumer's
+	uint64_t tail __attribute__((aligned(VMA_CACHE_LINE)));	 // the producer's
+} ring_t;
+
+// ===== Ring functions =====
+void ring_init(ring_t *ring, uint64_t capacity);
+void ring_destroy(ring_t *ring);
+void ring_push(ring_t *ring, void *item);
+void *ring_pop(ring_t *ring);
+int ring_empty(ring_t *ring);
@@ -0,0 +1,175 @@
+// Similea Alin-Andrei 314CA
+#include "snapshot.h"
+
+// The addresses of each segment(the last one can be shorter).
+static uint64_t segment_size(const arena_t *arena)
+{
+	uint64_t size = (arena->arena_size + SNAP_NR_SEGMENTS - 1) /
+					SNAP_NR_SEGMENTS;
+
+	return size ? size : 1;
+}
+
+static void drop_segment(snap_segment_t *seg)
+{
+	if (seg && __atomic_sub_fetch(&seg->refs, 1, __ATOMIC_ACQ_REL) == 0)
+		free(seg);
+}
+
+// Copies the blocks starting in [first, end), with their miniblocks. Returns
+// NULL if there are none. The caller holds the tree lock, shared.
+static snap_segment_t *build_segment(const arena_t *arena, uint64_t first,
+									 uint64_t end)
+{
+	avl_node_t *first_node = avl_ceil(arena->alloc_tree, first);
+	uint64_t nr_blocks = 0, nr_miniblocks = 0;
+
+	// A first walk counts them, so the segment is a single allocation.
+	for (avl_node_t *curr = first_node; curr && curr->key < end;
+		 curr = avl_next(curr)) {
+		block_t *curr_block = (block_t *)curr->data;
+		nr_blocks++;
+		nr_miniblocks += ((list_t *)curr_block->miniblock_list)->total_elements;
+	}
+	if (!nr_blocks)
+		return NULL;
+
+	snap_segment_t *seg = malloc(sizeof(*seg) +
+								 nr_blocks * sizeof(snap_block_t) +
+								 nr_miniblocks * sizeof(snap_minib_t));
+	DIE(!seg, "malloc failed");
+	seg->refs = 1;
+	seg->nr_blocks = nr_blocks;
+	seg->blocks = (snap_block_t *)(seg + 1);
+	seg->miniblocks = (snap_minib_t *)(seg->blocks + nr_blocks);
+
+	snap_minib_t *minib_copy = seg->miniblocks;
+	avl_node_t *curr_node_b = first_node;
+	for (uint64_t i = 0; i < nr_blocks; i++) {
+		block_t *curr_block = (block_t *)curr_node_b->data;
+		list_t *miniblock_list = (list_t *)curr_block->miniblock_list;
+
+		seg->blocks[i].start_address = curr_block->start_address;
+		seg->blocks[i].size = curr_block->size;
+		seg->blocks[i].nr_miniblocks = miniblock_list->total_elements;
+
+		for (node_t *curr = miniblock_list->head; curr; curr = curr->next) {
+			miniblock_t *minib = (miniblock_t *)curr->data;
+			minib_copy->start_address = minib->start_address;
+			minib_copy->size = minib->size;
+			minib_copy->perm = minib->perm;
+			minib_copy++;
+		}
+		curr_node_b = avl_next(curr_node_b);
+	}
+
+	return seg;
+}
+
+// Builds a snapshot of the arena out of the segments of "last"(NULL if there
+// is none) that didn't change since it was taken and new copies of the others.
+// The caller holds the tree lock, shared.
+static snapshot_t *build_snapshot(arena_t *arena, const snapshot_t *last)
+{
+	uint64_t seg_size = segment_size(arena);
+	uint64_t nr_segments = (arena->arena_size + seg_size - 1) / seg_size;
+
+	// The snapshot and its table of segments go in a single allocation.
+	snapshot_t *snap = malloc(sizeof(*snap) +
+							  nr_segments * sizeof(snap_segment_t *));
+	DIE(!snap, "malloc failed");
+	snap->segments = (snap_segment_t **)(snap + 1);
+
+	snap->epoch = arena->epoch;
+	snap->refs = 1;
+	snap->arena_size = arena->arena_size;
+	snap->free_memory = arena->arena_size - arena->allocated_memory;
+	snap->nr_blocks = avl_get_size(arena->alloc_tree);
+	snap->nr_miniblocks = avl_get_size(arena->minib_index);
+	snap->nr_segments = nr_segments;
+
+	for (uint64_t i = 0; i < nr_segments; i++) {
+		snap_segment_t *seg = last ? last->segments[i] : NULL;
+
+		if (last && !(arena->snap_dirty[i / 8] & (1 << (i % 8)))) {
+			if (seg)
+				__atomic_add_fetch(&seg->refs, 1, __ATOMIC_RELAXED);
+		} else {
+			seg = build_segment(arena, i * seg_size, (i + 1) * seg_size);
+		}
+		snap->segments[i] = seg;
+	}
+
+	// A concurrent arena publishes every snapshot it builds, so from now on
+	// the changes are counted against this one.
+	if (arena->locks && !arena->snap_dirty) {
+		arena->snap_dirty = calloc((nr_segments + 7) / 8, 1);
+		DIE(!arena->snap_dirty, "calloc failed");
+	} else if (arena->locks) {
+		memset(arena->snap_dirty, 0, (nr_segments + 7) / 8);
+	}
+	return snap;
+}
+
+// Returns a snapshot of the arena, to be given back with "drop_snapshot".
+// The last snapshot of a concurrent arena is reused while the arena doesn't
+// change. Otherwise, a new one is built under the shared tree lock, copying
+// only the segments changed since the last one, so the writers only wait for
+// those, never for what is done with it. The readers wait for each other(only
+// one snapshot is built at a time), the writers never take their lock.
+snapshot_t *take_snapshot(arena_t *arena)
+{
+	lock_snapshot(arena->locks);
+	snapshot_t *snap = arena->snapshot;
+	if (snap && snap->epoch == __atomic_load_n(&arena->epoch,
+											   __ATOMIC_ACQUIRE)) {
+		__atomic_add_fetch(&snap->refs, 1, __ATOMIC_RELAXED);
+		unlock_snapshot(arena->locks);
+		return snap;
+	}
+
+	lock_tree(arena->locks, 0);
+	snap = build_snapshot(arena, arena->snapshot);
+	unlock_tree(arena->locks);
+
+	if (arena->locks) {
+		drop_snapshot(arena->snapshot);
+		snap->refs++;
+		arena->snapshot = snap;
+	}
+	unlock_snapshot(arena->locks);
+	return snap;
+}
+
+// Gives back a reference to a snapshot. The last one frees it, with the
+// segments no other snapshot shares.
+void drop_snapshot(snapshot_t *snap)
+{
+	if (!snap || __atomic_sub_fetch(&snap->refs, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	for (uint64_t i = 0; i < snap->nr_segments; i++)
+		drop_segment(snap->segments[i]);
+	free(snap);
+}
+
+// Tells the published snapshot that the structure changed over the zone: the
+// segments of the blocks it touches are copied again by the next one. The
+// caller holds the tree lock alone.
+void snapshot_changed(arena_t *arena, uint64_t address, uint64_t size)
+{
+	if (!arena->snap_dirty || !size)
+		return;
+
+	// The block holding the zone can start in an earlier segment.
+	avl_node_t *block_node = avl_floor(arena->alloc_tree, address);
+	block_t *block = block_node ? (block_t *)block_node->data : NULL;
+	uint64_t seg_size = segment_size(arena), first = address;
+	uint64_t last = (address + size - 1) / seg_size;
+
+	if (block && address - block->start_address < block->size)
+		first = block->start_address;
+
+	for (uint64_t i = first / seg_size; i <= last; i++)
+		arena->snap_dirty[i / 8] |= 1 << (i % 8);
+}
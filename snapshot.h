@@ -0,0 +1,51 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+#include "vma.h"
+
+// A consistent copy of the blocks and miniblocks of an arena, taken at a
+// certain epoch(the number of changes of the structure so far). Once built, a
+// snapshot never changes, so it is read without any lock. A concurrent arena
+// keeps the last snapshot and hands it out again as long as its epoch didn't
+// move, so monitoring an idle arena doesn't touch its locks at all.
+// The addresses of the arena are cut into SNAP_NR_SEGMENTS equal segments and
+// each segment holds the blocks that start in it. The writers mark the
+// segments they change("snapshot_changed"), so the next snapshot only copies
+// those again and shares the others with the last one.
+#define SNAP_NR_SEGMENTS 1024
+
+typedef struct {
+	uint64_t start_address;
+	uint64_t size;
+	uint64_t nr_miniblocks;	 // the next ones in the array of miniblocks
+} snap_block_t;
+
+typedef struct {
+	uint64_t start_address;
+	uint64_t size;
+	uint8_t perm;
+} snap_minib_t;
+
+typedef struct {
+	unsigned int refs;	// the snapshots that share it
+	uint64_t nr_blocks;
+	snap_block_t *blocks;
+	snap_minib_t *miniblocks;
+} snap_segment_t;
+
+typedef struct snapshot {
+	uint64_t epoch;
+	unsigned int refs;	// the arena's(if published) and the readers'
+	uint64_t arena_size;
+	uint64_t free_memory;
+	uint64_t nr_blocks;
+	uint64_t nr_miniblocks;
+	uint64_t nr_segments;
+	snap_segment_t **segments;	// NULL where no block starts
+} snapshot_t;
+
+// ===== Snapshot functions =====
+snapshot_t *take_snapshot(arena_t *arena);
+void drop_snapshot(snapshot_t *snap);
+void snapshot_changed(arena_t *arena, uint64_t address, uint64_t size);
@@ -0,0 +1,62 @@
+// Similea Alin-Andrei 314CA
+#include "tlb.h"
+
+#include "vma.h"
+
+tlb_t *tlb_create(uint64_t nr_entries)
+{
+	tlb_t *tlb = pool_alloc(pool_get(sizeof(*tlb)));
+
+	tlb->entries = NULL;
+	tlb->nr_entries = 0;
+	tlb->hits = 0;
+	tlb->misses = 0;
+	tlb_resize(tlb, nr_entries);
+	return tlb;
+}
+
+void tlb_destroy(tlb_t *tlb)
+{
+	free(tlb->entries);
+	pool_free(pool_get(sizeof(*tlb)), tlb);
+}
+
+// Gives the cache another number of entries(a power of two, or 0 to turn it
+// off), all empty. Returns 0 for an invalid number.
+int tlb_resize(tlb_t *tlb, uint64_t nr_entries)
+{
+	if (nr_entries & (nr_entries - 1))
+		return 0;
+
+	free(tlb->entries);
+	tlb->entries = NULL;
+	if (nr_entries) {
+		tlb->entries = calloc(nr_entries, sizeof(*tlb->entries));
+		DIE(!tlb->entries, "calloc failed");
+	}
+	tlb->nr_entries = nr_entries;
+	return 1;
+}
+
+void tlb_flush(tlb_t *tlb)
+{
+	if (tlb->nr_entries)
+		memset(tlb->entries, 0, tlb->nr_entries * sizeof(*tlb->entries));
+}
+
+// Returns the entry of the page holding the address, emptied first if it held
+// another page(NULL if the cache is off).
+tlb_entry_t *tlb_slot(tlb_t *tlb, uint64_t address)
+{
+	if (!tlb->nr_entries)
+		return NULL;
+
+	uint64_t page = address / VMA_PAGE_SIZE;
+	tlb_entry_t *entry = &tlb->entries[page & (tlb->nr_entries - 1)];
+	if (entry->page != page + 1) {
+		entry->page = page + 1;
+		entry->block = NULL;
+		entry->minib = NULL;
+	}
+	return entry;
+}
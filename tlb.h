@@ -0,0 +1,36 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+#include "avl.h"
+#include "list.h"
+
+// A direct-mapped cache in front of "find_block" and "find_miniblock": each
+// page number has a single entry, which keeps the block and the miniblock last
+// found on that page. The entries only hold nodes, so a hit is checked against
+// the current borders of the block or the miniblock: blocks that grew or were
+// split and miniblocks that were cut(or changed their permissions) need no
+// invalidation. The cache is only emptied when nodes are freed(FREE_BLOCK and
+// an ALLOC_BLOCK that merges three blocks). The arenas shared by threads
+// don't use it, as the lookups only hold the tree lock for reading.
+#define VMA_TLB_ENTRIES 64	// the default size, a power of two
+
+typedef struct {
+	uint64_t page;	// the page number + 1, 0 for an empty entry
+	avl_node_t *block;	// NULL if not known yet
+	node_t *minib;	// NULL if not known yet
+} tlb_entry_t;
+
+typedef struct tlb {
+	tlb_entry_t *entries;
+	uint64_t nr_entries;  // a power of two, 0 if the cache is off
+	uint64_t hits;
+	uint64_t misses;
+} tlb_t;
+
+// ===== Translation cache functions =====
+tlb_t *tlb_create(uint64_t nr_entries);
+void tlb_destroy(tlb_t *tlb);
+int tlb_resize(tlb_t *tlb, uint64_t nr_entries);
+void tlb_flush(tlb_t *tlb);
+tlb_entry_t *tlb_slot(tlb_t *tlb, uint64_t address);
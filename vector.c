@@ -0,0 +1,147 @@
+// Similea Alin-Andrei 314CA
+#include "vector.h"
+
+#include "locks.h"
+#include "metrics.h"
+#include "perms.h"
+
+static int compare_segments(const void *a, const void *b)
+{
+	uint64_t x = (*(const segment_t *const *)a)->address;
+	uint64_t y = (*(const segment_t *const *)b)->address;
+
+	return (x > y) - (x < y);
+}
+
+// Checks all the zones, in the order of their addresses: a zone in the same
+// block as the one before it needs no lookup, and only its bytes after the
+// ones already checked need a look at their permissions.
+// mode = 4 -> READ; mode = 2 -> WRITE
+static int check_segments(arena_t *arena, segment_t *segs, uint32_t nr_segs,
+						  int mode)
+{
+	segment_t **order = malloc(nr_segs * sizeof(*order));
+	block_t *block = NULL;
+	uint64_t checked_end = 0;  // the bytes before it have the permission
+	int status = VMA_OK;
+
+	DIE(!order, "malloc failed");
+	for (uint32_t i = 0; i < nr_segs; i++)
+		order[i] = &segs[i];
+	qsort(order, nr_segs, sizeof(*order), compare_segments);
+
+	for (uint32_t i = 0; i < nr_segs; i++) {
+		segment_t *seg = order[i];
+		if (!block || seg->address - block->start_address >= block->size) {
+			block = find_block(arena, seg->address, NULL);
+			if (!block) {
+				status = mode == 4 ? VMA_INVALID_READ : VMA_INVALID_WRITE;
+				break;
+			}
+		}
+
+		uint64_t block_end = block->start_address + block->size;
+		seg->length = seg->size;
+		if (block_end - seg->address < seg->size) {
+			seg->length = block_end - seg->address;
+			status |= VMA_TRUNCATED;
+		}
+
+		// Even with no bytes, the byte at the address is checked.
+		uint64_t end = seg->address + (seg->length ? seg->length : 1);
+		if (end <= checked_end)
+			continue;
+		uint64_t from = seg->address > checked_end ? seg->address
+												   : checked_end;
+		if (!perms_check(arena, from, end - from, mode)) {
+			status = mode == 4 ? VMA_PERM_READ : VMA_PERM_WRITE;
+			break;
+		}
+		checked_end = end;
+	}
+
+	free(order);
+	return status;
+}
+
+// The stripes of all the zones.
+static uint64_t segments_mask(const segment_t *segs, uint32_t nr_segs)
+{
+	uint64_t mask = 0;
+
+	for (uint32_t i = 0; i < nr_segs; i++)
+		mask |= stripe_mask(segs[i].address, segs[i].length);
+	return mask;
+}
+
+// Checks the zones of a READV or a WRITEV, under the tree lock. If they can
+// all be used, they stay locked until "release_segments" is called for them.
+static int start_segments(arena_t *arena, segment_t *segs, uint32_t nr_segs,
+						  int mode)
+{
+	if (!arena)
+		return mode == 4 ? VMA_INVALID_READ : VMA_INVALID_WRITE;
+
+	lock_tree(arena->locks, 0);
+	int status = check_segments(arena, segs, nr_segs, mode);
+	if (status == VMA_OK || status == VMA_TRUNCATED)
+		lock_stripes(arena->locks, segments_mask(segs, nr_segs), mode == 2);
+	unlock_tree(arena->locks);
+	return status;
+}
+
+// Checks whether all the zones can be read. Each one gets in "length" how many
+// of its bytes are in its block: if any of them was cut, the result also has
+// the VMA_TRUNCATED flag. If they can be read, they stay locked for reading
+// until "release_segments" is called for them.
+int read_segments(arena_t *arena, segment_t *segs, uint32_t nr_segs)
+{
+	int status = start_segments(arena, segs, nr_segs, 4);
+
+	if (status == VMA_OK || status == VMA_TRUNCATED)
+		for (uint32_t i = 0; i < nr_segs; i++)
+			METRICS_ADD(metrics.bytes_read, segs[i].length);
+	return status;
+}
+
+// Same as "read_segments", for writing: the "length" bytes of each zone go at
+// "base + address" in the arena.
+int write_segments(arena_t *arena, segment_t *segs, uint32_t nr_segs)
+{
+	int status = start_segments(arena, segs, nr_segs, 2);
+
+	if (status == VMA_OK || status == VMA_TRUNCATED) {
+		for (uint32_t i = 0; i < nr_segs; i++) {
+			mark_written(arena, segs[i].address, segs[i].length);
+			METRICS_ADD(metrics.bytes_written, segs[i].length);
+		}
+	}
+	return status;
+}
+
+// Unlocks the zones locked by "read_segments" or "write_segments".
+void release_segments(arena_t *arena, const segment_t *segs,
+					  uint32_t nr_segs)
+{
+	unlock_stripes(arena->locks, segments_mask(segs, nr_segs));
+}
+
+// Prints the bytes of all the zones, in the order they were given, on a single
+// line. The warning, if some zones were cut, gives the bytes of all of them.
+void read_vector(arena_t *arena, segment_t *segs, uint32_t nr_segs,
+				 FILE *out)
+{
+	uint64_t total = 0;
+	int status = read_segments(arena, segs, nr_segs);
+
+	if (status == VMA_OK || status == VMA_TRUNCATED)
+		for (uint32_t i = 0; i < nr_segs; i++)
+			total += segs[i].length;
+	if (print_status(status, "Reading", total, out))
+		return;
+
+	for (uint32_t i = 0; i < nr_segs; i++)
+		print_zone(arena, segs[i].address, segs[i].length, out);
+	fputc('\n', out);
+	release_segments(arena, segs, nr_segs);
+}
@@ -0,0 +1,27 @@
+// Similea Alin-Andrei 314CA
+#pragma once
+#include <inttypes.h>
+
+#include "vma.h"
+
+// Vectored reads and writes(READV, WRITEV): a list of zones handled as one
+// command. The zones are checked in the order of their addresses, so the
+// zones in the same block share a single lookup and every byte has its
+// permissions checked once, even when the zones overlap or share pages. Each
+// zone must start in a block and is cut to its end like the zone of a READ or
+// a WRITE. Either all the zones are done or none of them.
+#define VMA_MAX_SEGMENTS 4096  // the zones of a single command
+
+typedef struct {
+	uint64_t address;
+	uint64_t size;	// the bytes asked for
+	uint64_t length;  // the bytes in the block, set by the checks
+} segment_t;
+
+// ===== Vectored read/write functions =====
+int read_segments(arena_t *arena, segment_t *segs, uint32_t nr_segs);
+int write_segments(arena_t *arena, segment_t *segs, uint32_t nr_segs);
+void release_segments(arena_t *arena, const segment_t *segs,
+					  uint32_t nr_segs);
+void read_vector(arena_t *arena, segment_t *segs, uint32_t nr_segs,
+				 FILE *out);
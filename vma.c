@@ -1,648 +1,1144 @@
 // Similea Alin-Andrei 314CA
 #include "vma.h"
 
+#include "checkpoint.h"
+#include "gaps.h"
 #include "list.h"
+#include "mem.h"
+#include "metrics.h"
+#include "perms.h"
+#include "radix.h"
+#include "snapshot.h"
+#include "tlb.h"
+
+// Every page that was never written reads from here.
+static const uint8_t zero_page[VMA_PAGE_SIZE];
+
+// Gives back the ranges reserved for an arena of given size(the ones that are
+// NULL were never reserved).
+static void release_ranges(uint64_t size, uint8_t *base, uint8_t *written_pages,
+						   uint8_t *page_perms, uint8_t *written_bytes)
+{
+	if (base)
+		mem_release(base, size);
+	if (written_pages)
+		mem_release(written_pages, bitmap_size(size));
+	if (page_perms)
+		mem_release(page_perms, perm_table_size(size));
+	if (written_bytes)
+		mem_release(written_bytes, (size + 7) / 8);
+}
 
 // We initialize the arena.
+// The whole address range is reserved at once: the system only gives it
+// physical pages when they are written, so even huge arenas are cheap. A
+// bitmap (reserved the same way) tells which pages were written, a table of
+// bytes the permissions of each page and a second bitmap which bytes were
+// written(only those are printed by READ). The arena itself comes from the
+// pool shared by all the arenas. Returns NULL if the ranges can't be
+// reserved(the arena doesn't fit in the address space).
 arena_t *alloc_arena(const uint64_t size)
 {
-	arena_t *arena = (arena_t *)malloc(sizeof(arena_t));
-	DIE(!arena, "malloc failed");
+	uint8_t *base = NULL, *written_pages = NULL, *page_perms = NULL;
+	uint8_t *written_bytes = NULL;
+
+	if (size) {
+		base = mem_reserve(size);
+		written_pages = mem_reserve(bitmap_size(size));
+		page_perms = mem_reserve(perm_table_size(size));
+		written_bytes = mem_reserve((size + 7) / 8);
+		if (!base || !written_pages || !page_perms || !written_bytes) {
+			release_ranges(size, base, written_pages, page_perms,
+						   written_bytes);
+			return NULL;
+		}
+	}
+
+	arena_t *arena = pool_alloc(pool_get(sizeof(arena_t)));
 	arena->arena_size = size;
-	arena->alloc_list = ll_create(sizeof(block_t));
+	arena->alloc_tree = avl_create(sizeof(block_t));
+	arena->minib_index = avl_create(sizeof(node_t *));
+	arena->gaps = gaps_create(size);
+
+	arena->base = base;
+	arena->written_pages = written_pages;
+	arena->page_perms = page_perms;
+	arena->written_bytes = written_bytes;
+	arena->nr_written_pages = 0;
+	arena->nr_written_bytes = 0;
+	arena->allocated_memory = 0;
+	arena->file_backed = 0;
+	arena->locks = NULL;
+	arena->epoch = 0;
+	arena->snapshot = NULL;
+	arena->snap_dirty = NULL;
+	arena->radix = NULL;
+	arena->tlb = tlb_create(VMA_TLB_ENTRIES);
 
 	return arena;
 }
 
-// Free the memory of all the rw_buffers from a list of miniblocks from a
-// single block.
-void free_buffers(list_t *minib_list)
+// Makes the arena safe to use from more than one thread(concurrent mode). It
+// must be called before the other threads start using it.
+void make_concurrent(arena_t *arena)
 {
-	node_t *curr_minib_node = minib_list->head;
-	for (unsigned int i = 0; i < minib_list->total_elements; i++) {
-		miniblock_t *curr_minib = (miniblock_t *)curr_minib_node->data;
-		if (curr_minib->rw_buffer) {
-			free(curr_minib->rw_buffer);
-			curr_minib->rw_buffer = NULL;
+	if (arena->locks)
+		return;
+	arena->locks = locks_create();
+	pool_enable_locking();
+}
+
+// Makes the arena translate its addresses through a page table(the radix
+// engine). It must be called before the first block is allocated.
+int make_radix(arena_t *arena)
+{
+	if (arena->arena_size > RADIX_MAX_SIZE)
+		return VMA_INVALID_ENGINE;
+	if (!arena->radix)
+		arena->radix = radix_create();
+	return VMA_OK;
+}
+
+// Number of bytes of the bitmap of written pages for an arena of given size.
+uint64_t bitmap_size(uint64_t arena_size)
+{
+	uint64_t nr_pages = (arena_size + VMA_PAGE_SIZE - 1) / VMA_PAGE_SIZE;
+
+	return (nr_pages + 7) / 8;
+}
+
+// Tells whether a page was written(it has storage of its own).
+int page_written(const arena_t *arena, uint64_t page)
+{
+	return (arena->written_pages[page / 8] >> (page % 8)) & 1;
+}
+
+// Marks the pages of a zone as written. From now on they are read from the
+// arena instead of the zero page.
+void mark_pages_written(arena_t *arena, uint64_t address, uint64_t size)
+{
+	if (!size)
+		return;
+
+	uint64_t last = (address + size - 1) / VMA_PAGE_SIZE;
+	for (uint64_t page = address / VMA_PAGE_SIZE; page <= last; page++) {
+		if (!page_written(arena, page)) {
+			arena->written_pages[page / 8] |= 1 << (page % 8);
+			__atomic_fetch_add(&arena->nr_written_pages, 1, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+// Tells whether a byte was written since its block was allocated.
+int byte_written(const arena_t *arena, uint64_t address)
+{
+	return (arena->written_bytes[address / 8] >> (address % 8)) & 1;
+}
+
+// Counts the written bytes marked in the bytes [first, first + len) of the
+// bitmap, a word at a time.
+uint64_t count_written(const arena_t *arena, uint64_t first, uint64_t len)
+{
+	uint64_t count = 0, word;
+	uint64_t i = 0;
+
+	for (; i + sizeof(word) <= len; i += sizeof(word)) {
+		memcpy(&word, arena->written_bytes + first + i, sizeof(word));
+		count += __builtin_popcountll(word);
+	}
+	for (; i < len; i++)
+		count += __builtin_popcount(arena->written_bytes[first + i]);
+	return count;
+}
+
+// Marks the bytes of a zone as written or not. The whole bytes of the bitmap
+// are set at once, only the bits at the ends one by one. The number of written
+// bytes of the arena changes by the bits that really flipped.
+void set_written(arena_t *arena, uint64_t address, uint64_t size, int written)
+{
+	uint64_t end = address + size, before = 0;
+
+	for (; address < end && address % 8; address++) {
+		before += byte_written(arena, address);
+		if (written)
+			arena->written_bytes[address / 8] |= 1 << (address % 8);
+		else
+			arena->written_bytes[address / 8] &= ~(1 << (address % 8));
+	}
+	if (end - address >= 8) {
+		uint64_t len = (end - address) / 8;
+		before += count_written(arena, address / 8, len);
+		memset(arena->written_bytes + address / 8, written ? 0xFF : 0, len);
+		address += len * 8;
+	}
+	for (; address < end; address++) {
+		before += byte_written(arena, address);
+		if (written)
+			arena->written_bytes[address / 8] |= 1 << (address % 8);
+		else
+			arena->written_bytes[address / 8] &= ~(1 << (address % 8));
+	}
+
+	if (written)
+		__atomic_fetch_add(&arena->nr_written_bytes, size - before,
+						   __ATOMIC_RELAXED);
+	else
+		__atomic_fetch_sub(&arena->nr_written_bytes, before, __ATOMIC_RELAXED);
+}
+
+// Returns where the run of bytes from "address" that are all written(or all
+// not written) ends, at most at "end". The words and the bytes of the bitmap
+// that are full(or empty) are skipped at once.
+uint64_t written_run(const arena_t *arena, uint64_t address, uint64_t end,
+					 int written)
+{
+	uint64_t whole_word = written ? UINT64_MAX : 0, word;
+	uint8_t whole = written ? 0xFF : 0;
+
+	while (address < end) {
+		if (address % 64 == 0 && end - address >= 64) {
+			memcpy(&word, arena->written_bytes + address / 8, sizeof(word));
+			if (word == whole_word) {
+				address += 64;
+				continue;
+			}
+		}
+		if (address % 8 == 0 && end - address >= 8 &&
+			arena->written_bytes[address / 8] == whole) {
+			address += 8;
+			continue;
+		}
+		if (byte_written(arena, address) != written)
+			break;
+		address++;
+	}
+	return address;
+}
+
+// Marks a zone as written: its pages get storage of their own and its bytes
+// are printed by READ.
+void mark_written(arena_t *arena, uint64_t address, uint64_t size)
+{
+	mark_pages_written(arena, address, size);
+	set_written(arena, address, size, 1);
+}
+
+// Returns where the bytes of a page are read from: the arena itself for the
+// written pages and the shared zero page for all the others.
+const uint8_t *page_data(const arena_t *arena, uint64_t page)
+{
+	if (page_written(arena, page))
+		return arena->base + page * VMA_PAGE_SIZE;
+	return zero_page;
+}
+
+// Copies "size" bytes of the arena, starting from "address", to "dest".
+void copy_bytes(const arena_t *arena, uint64_t address, uint64_t size,
+				uint8_t *dest)
+{
+	uint64_t end = address + size;
+
+	while (address < end) {
+		uint64_t offset = address % VMA_PAGE_SIZE;
+		uint64_t segment = VMA_PAGE_SIZE - offset;
+		if (segment > end - address)
+			segment = end - address;
+
+		memcpy(dest, page_data(arena, address / VMA_PAGE_SIZE) + offset,
+			   segment);
+		dest += segment;
+		address += segment;
+	}
+}
+
+// Clears the bytes of a freed zone, so the next block allocated there starts
+// zeroed and none of its bytes counts as written. The pages freed whole are
+// given back to the system and read from the zero page again, only the written
+// parts of the others are set to zero.
+void clear_memory(arena_t *arena, uint64_t address, uint64_t size)
+{
+	uint64_t end = address + size;
+
+	set_written(arena, address, size, 0);
+	uint64_t first_page = (address + VMA_PAGE_SIZE - 1) / VMA_PAGE_SIZE;
+	uint64_t last_page = end / VMA_PAGE_SIZE;
+
+	// No whole page: the zone is on one page or across the end of one.
+	if (first_page >= last_page) {
+		uint64_t split = (address / VMA_PAGE_SIZE + 1) * VMA_PAGE_SIZE;
+		if (split > end)
+			split = end;
+		if (page_written(arena, address / VMA_PAGE_SIZE))
+			memset(arena->base + address, 0, split - address);
+		if (split < end && page_written(arena, split / VMA_PAGE_SIZE))
+			memset(arena->base + split, 0, end - split);
+		return;
+	}
+
+	uint64_t head = first_page * VMA_PAGE_SIZE;
+	uint64_t tail = last_page * VMA_PAGE_SIZE;
+	if (head != address && page_written(arena, first_page - 1))
+		memset(arena->base + address, 0, head - address);
+	if (tail != end && page_written(arena, last_page))
+		memset(arena->base + tail, 0, end - tail);
+
+	// The pages mapped from a checkpoint would read as the file again. If
+	// they can't be replaced, they are overwritten.
+	if (arena->file_backed) {
+		if (!mem_zero(arena->base + head, tail - head))
+			memset(arena->base + head, 0, tail - head);
+	} else {
+		mem_discard(arena->base + head, tail - head);
+	}
+	for (uint64_t page = first_page; page < last_page; page++) {
+		if (page_written(arena, page)) {
+			arena->written_pages[page / 8] &= ~(1 << (page % 8));
+			__atomic_fetch_sub(&arena->nr_written_pages, 1, __ATOMIC_RELAXED);
 		}
-		if (curr_minib_node->next)
-			curr_minib_node = curr_minib_node->next;
 	}
 }
 
 // Free the memory of the arena.
 void dealloc_arena(arena_t *arena)
 {
-	// For each block remaining in the list, we deallocate its miniblock
-	// buffers, miniblock list and then the block itself.
-	while (arena->alloc_list->total_elements) {
-		node_t *curr = arena->alloc_list->head;
+	// For each block remaining in the tree, we deallocate its miniblock list.
+	avl_node_t *curr = avl_first(arena->alloc_tree);
+	while (curr) {
 		block_t *curr_block = (block_t *)curr->data;
 		list_t *curr_mb_list = (list_t *)curr_block->miniblock_list;
-		free_buffers(curr_mb_list);
 		ll_free(&curr_mb_list);
-		free_node(arena->alloc_list, 0);
+		curr = avl_next(curr);
+	}
+
+	// deallocate the block tree together with the blocks, the miniblock index,
+	// the free zones, the page table, the translation cache, the bytes of the
+	// arena and the arena itself.
+	avl_free(&arena->alloc_tree);
+	avl_free(&arena->minib_index);
+	gaps_destroy(arena->gaps);
+	radix_destroy(arena->radix);
+	tlb_destroy(arena->tlb);
+	release_ranges(arena->arena_size, arena->base, arena->written_pages,
+				   arena->page_perms, arena->written_bytes);
+	drop_snapshot(arena->snapshot);
+	free(arena->snap_dirty);
+	locks_destroy(arena->locks);
+	pool_free(pool_get(sizeof(arena_t)), arena);
+}
+
+// ===================
+// ARENA HANDLES
+// ===================
+
+// Initializes an empty table of arenas.
+void arenas_init(arena_table_t *table)
+{
+	table->arenas = NULL;
+	table->capacity = 0;
+	table->nr_arenas = 0;
+	table->engine = VMA_ENGINE_TREE;
+}
+
+// Returns the arena with the given handle(NULL if there is none).
+arena_t *get_arena(const arena_table_t *table, uint64_t handle)
+{
+	if (handle >= table->capacity)
+		return NULL;
+	return table->arenas[handle];
+}
+
+// Puts an arena in the table under the given handle. An arena that already had
+// the handle is deallocated first.
+static void put_arena(arena_table_t *table, uint64_t handle, arena_t *arena)
+{
+	if (handle >= table->capacity) {
+		uint32_t capacity = table->capacity ? table->capacity : 16;
+		while (capacity <= handle)
+			capacity *= 2;
+
+		arena_t **arenas = realloc(table->arenas,
+								   capacity * sizeof(*arenas));
+		DIE(!arenas, "realloc failed");
+		memset(arenas + table->capacity, 0,
+			   (capacity - table->capacity) * sizeof(*arenas));
+		table->arenas = arenas;
+		table->capacity = capacity;
 	}
 
-	// deallocate the main block list. (the arena itself will be freed in the
-	// main function)
-	free(arena->alloc_list);
-	arena->alloc_list = NULL;
+	destroy_arena(table, handle);
+	table->arenas[handle] = arena;
+	table->nr_arenas++;
+}
+
+// Creates an arena of the given size under the given handle, with the given
+// engine(see "vma.h").
+int create_arena(arena_table_t *table, uint64_t handle, uint64_t size,
+				 int engine)
+{
+	if (handle >= VMA_MAX_ARENAS)
+		return VMA_INVALID_HANDLE;
+	if (engine < 0 || engine >= VMA_NR_ENGINES ||
+		(engine == VMA_ENGINE_RADIX && size > RADIX_MAX_SIZE))
+		return VMA_INVALID_ENGINE;
+
+	arena_t *arena = alloc_arena(size);
+	if (!arena)
+		return VMA_INVALID_SIZE;
+	if (engine == VMA_ENGINE_RADIX)
+		make_radix(arena);
+	put_arena(table, handle, arena);
+	return VMA_OK;
+}
+
+// Loads the arena saved at "path"(see "checkpoint.h") under the given handle.
+// The arena that had the handle is only replaced if the checkpoint is valid.
+int load_arena(arena_table_t *table, uint64_t handle, const char *path)
+{
+	arena_t *arena;
+
+	if (handle >= VMA_MAX_ARENAS)
+		return VMA_INVALID_HANDLE;
+	int status = load_checkpoint(path, &arena);
+	if (status == VMA_OK)
+		put_arena(table, handle, arena);
+	return status;
+}
+
+// Deallocates the arena with the given handle.
+int destroy_arena(arena_table_t *table, uint64_t handle)
+{
+	arena_t *arena = get_arena(table, handle);
+
+	if (!arena)
+		return VMA_NO_ARENA;
+	dealloc_arena(arena);
+	table->arenas[handle] = NULL;
+	table->nr_arenas--;
+	return VMA_OK;
+}
+
+// Deallocates all the arenas and the table itself.
+void destroy_all_arenas(arena_table_t *table)
+{
+	for (uint32_t i = 0; i < table->capacity && table->nr_arenas; i++)
+		destroy_arena(table, i);
+	free(table->arenas);
+	arenas_init(table);
 }
 
 // Concatenates a given(new) block to another given(old) block.
 // idx = -1 -> add the new block after the old one. (1.OLD, 2.NEW)
 // idx = 1 -> add the new block before the old one. (1.NEW, 2.OLD)
+// The miniblock nodes are spliced, not copied, so this takes the same time no
+// matter how many miniblocks the blocks have.
 void concat_block(block_t *old_block, block_t *new_block, int idx)
 {
 	old_block->size += new_block->size;
 	list_t *old_miniblock_list = (list_t *)old_block->miniblock_list;
 	list_t *new_miniblock_list = (list_t *)new_block->miniblock_list;
 
-	// We add the new one after the old one. (1.OLD, 2.NEW)
-	if (idx == -1) {
-		while (new_miniblock_list->total_elements) {
-			// Add the first new block's node after the last old block's node.
-			node_t *curr_minib = new_miniblock_list->head;
-			ll_add_nth_node(old_miniblock_list,
-							old_miniblock_list->total_elements,
-							curr_minib->data);
-
-			// free the old node memory, because of deep copy in ll_add_nth_node
-			free_node(new_miniblock_list, 0);
-		}
-	}
-
 	// We add the new one before the old one. (1.NEW, 2.OLD)
-	if (idx == 1) {
+	if (idx == 1)
 		old_block->start_address = new_block->start_address;
-		while (new_miniblock_list->total_elements) {
-			// Add the last new block's node before the first old block's node.
-			node_t *minib_current = new_miniblock_list->head;
-			for (unsigned int i = 0; i < new_miniblock_list->total_elements - 1;
-				 i++)
-				minib_current = minib_current->next;
-			ll_add_nth_node(old_miniblock_list, 0, minib_current->data);
-
-			// free the old node memory, because of deep copy in ll_add_nth_node
-			free_node(new_miniblock_list, new_miniblock_list->total_elements);
-		}
-	}
-	// free the new block's memory, because we concatenated it in the old block.
+	ll_splice(old_miniblock_list, new_miniblock_list, idx == 1);
+
+	// free the new block's (now empty) list, because we concatenated it in the
+	// old block.
 	ll_free((list_t **)&new_block->miniblock_list);
 }
 
 // Handles the various errors a block allocation can give in terms of the arena
 // not being previously allocated and in terms of the block's beginning and end
-// address being out of the arena's borders.
+// address being out of the arena's borders. Returns VMA_OK if there are none.
 int alloc_block_errors(arena_t *arena, uint64_t address, uint64_t end_addr_new)
 {
-	if (!arena) {
-		printf("Arena was not allocated.\n");
-		return 0;
-	}
-	if (address + 1 > arena->arena_size) {
-		printf("The allocated address is outside the size of arena\n");
-		return 0;
-	}
-	if (end_addr_new + 1 > arena->arena_size) {
-		printf("The end address is past the size of the arena\n");
-		return 0;
-	}
-	return 1;
+	if (!arena)
+		return VMA_NO_ARENA;
+	if (address + 1 > arena->arena_size)
+		return VMA_ADDRESS_OUTSIDE;
+	if (end_addr_new + 1 > arena->arena_size)
+		return VMA_END_OUTSIDE;
+	return VMA_OK;
 }
 
-// Used whether the new block we want to allocate is between TWO already
-// existing blocks.
-void cases_of_alloc_block(arena_t *arena, int k, block_t *prev_b,
-						  uint64_t prev_end, block_t *next_b,
-						  uint64_t next_start, block_t *new_block,
-						  uint64_t end_address_new)
+// Adds the new block to the arena depending on whether it is adjacent to its
+// neighbours (the blocks right before and right after it, if they exist).
+// Returns the tree node of the block that holds the new one in the end.
+avl_node_t *cases_of_alloc_block(arena_t *arena, avl_node_t *prev_node,
+								 avl_node_t *next_node, block_t *new_block,
+								 uint64_t end_address_new)
 {
+	block_t *prev_b = prev_node ? (block_t *)prev_node->data : NULL;
+	block_t *next_b = next_node ? (block_t *)next_node->data : NULL;
+	int adj_prev = prev_b && (prev_b->start_address + prev_b->size - 1 ==
+							  new_block->start_address - 1);
+	int adj_next = next_b && (end_address_new == next_b->start_address - 1);
+
 	// Case 1: The new block is adjacent to the previous and the next blocks.
 	// The result will be a single block made up of 3 blocks
-	if ((prev_end == new_block->start_address - 1) &&
-		(end_address_new == next_start - 1)) {
+	if (adj_prev && adj_next) {
 		// Concatenate the new block to the previous block.
 		concat_block(prev_b, new_block, -1);
-		// Concatenate the next block to the previously resulted block.
+		// Concatenate the next block to the previously resulted block. Its
+		// pages now belong to the previous block.
+		radix_rebind(arena->radix, next_b->start_address, next_b->size,
+					 prev_node);
 		concat_block(prev_b, next_b, -1);
 		// Free the memory of the next block, because it was concatenated to the
-		// previous one.
-		free_node(arena->alloc_list, k);
-		return;
+		// previous one. The translation cache may still point at it.
+		avl_remove(arena->alloc_tree, next_node);
+		tlb_flush(arena->tlb);
+		return prev_node;
 	}
 
 	// Case 2: The new block is only adjacent to the previous block.
-	if (prev_end == new_block->start_address - 1) {
+	if (adj_prev) {
 		// Concatenate the new block to the previous block.
 		concat_block(prev_b, new_block, -1);
-		return;
+		return prev_node;
 	}
 
 	// Case 3: The new block is only adjacent to the next block.
-	if (end_address_new == next_start - 1) {
-		// Concatenate the new block to the next block.
+	if (adj_next) {
+		// Concatenate the new block to the next block. The next block now
+		// starts earlier, but it keeps its place in the tree.
 		concat_block(next_b, new_block, 1);
-		return;
+		next_node->key = next_b->start_address;
+		return next_node;
 	}
 
 	// Case 4: The new block is not adjacent to any blocks, so we add it to the
-	// list normally.
-	ll_add_nth_node(arena->alloc_list, k, new_block);
+	// tree normally.
+	return avl_insert(arena->alloc_tree, new_block->start_address, new_block);
 }
 
-// Creates a basic block(with given starting address and size) that is going to
-// be put in the arena. -> function used in alloc_block
-block_t *init_new_block(uint64_t address, uint64_t size)
+// Initializes a basic block(with given starting address and size) that is going
+// to be put in the arena. -> function used in alloc_block
+// The block itself is filled in place (it is copied in the tree later), only
+// its miniblock list is allocated.
+void init_new_block(block_t *new_block, uint64_t address, uint64_t size)
 {
-	block_t *new_block = malloc(sizeof(block_t));
-	DIE(!new_block, "malloc failed");
 	new_block->size = size;
 	new_block->start_address = address;
 	new_block->miniblock_list = ll_create(sizeof(miniblock_t));
 
 	// list of miniblocks
-	miniblock_t *miniblock_l = malloc(sizeof(miniblock_t));
-	DIE(!miniblock_l, "malloc failed");
-	miniblock_l->size = size;
-	miniblock_l->start_address = address;
-	miniblock_l->perm = 6;	// default RW-
-	miniblock_l->rw_buffer = NULL;
-	ll_add_nth_node(new_block->miniblock_list, 0, miniblock_l);
-
-	// we free miniblock_l, because we made a deep copy inside ll_add_nth_node.
-	free(miniblock_l);
-	return new_block;
+	miniblock_t miniblock_l;
+	miniblock_l.size = size;
+	miniblock_l.start_address = address;
+	miniblock_l.perm = VMA_DEFAULT_PERM;
+	ll_add_nth_node(new_block->miniblock_list, 0, &miniblock_l);
 }
 
-// Create a block and add it in the list of blocks from the arena or, if
-// adjacent to other previously existing blocks, concatenate it to other blocks.
-void alloc_block(arena_t *arena, const uint64_t address, const uint64_t size)
+// Puts a new block(already checked against the borders of the arena) between
+// its neighbours.
+static int place_block(arena_t *arena, uint64_t address, uint64_t size)
 {
 	uint64_t end_address_new = address + size - 1;
-	if (!alloc_block_errors(arena, address, end_address_new))
-		return;
-	block_t *new_block = init_new_block(address, size);
 
-	// Case 1: There are no existing elements in the arena.
-	if (arena->alloc_list->total_elements == 0) {
-		ll_add_nth_node(arena->alloc_list, 0, new_block);
-		free(new_block);
-		return;
-	}
+	// The only blocks the new one could touch are the last block starting
+	// before it and the first block starting after it.
+	avl_node_t *prev_node = avl_floor(arena->alloc_tree, address);
+	avl_node_t *next_node = prev_node ? avl_next(prev_node)
+									  : avl_first(arena->alloc_tree);
 
-	// Case 2: New block would be positioned before the first block in the list.
-	node_t *first = arena->alloc_list->head;
-	block_t *b_first = (block_t *)first->data;
-	if (end_address_new < b_first->start_address) {
-		// Verify if the new block is adjacent to the existing first block.
-		if (end_address_new == b_first->start_address - 1) {
-			// Concatenate the new block to the old block.
-			concat_block(b_first, new_block, 1);
-		} else {
-			// Add the new block to the list of blocks in the arena.
-			ll_add_nth_node(arena->alloc_list, 0, new_block);
-		}
-		free(new_block);  // because of deep copy in ll_add_nth_node
-		return;
+	if (prev_node) {
+		block_t *prev_b = (block_t *)prev_node->data;
+		if (prev_b->start_address + prev_b->size - 1 >= address)
+			return VMA_ZONE_ALLOCATED;
 	}
-
-	// Case 3: New block would be positioned after the last block in the list.
-	node_t *last = arena->alloc_list->head;
-	for (unsigned int i = 0; i < arena->alloc_list->total_elements - 1; i++)
-		last = last->next;
-	block_t *b_last = (block_t *)last->data;
-	if (address > b_last->start_address + b_last->size - 1) {
-		// Verify if the new block is adjacent to the existing last block.
-		if (address == b_last->start_address + b_last->size) {
-			// Concatenate the new block to the old block.
-			concat_block(b_last, new_block, -1);
-		} else {
-			// Add the new block to the list of blocks in the arena.
-			ll_add_nth_node(arena->alloc_list,
-							arena->alloc_list->total_elements, new_block);
-		}
-		free(new_block);  // because of deep copy in ll_add_nth_node
-		return;
+	if (next_node) {
+		block_t *next_b = (block_t *)next_node->data;
+		if (next_b->start_address <= end_address_new)
+			return VMA_ZONE_ALLOCATED;
 	}
 
-	// Case 4: New block would be positioned between two already existing ones.
-	if (arena->alloc_list->total_elements >= 2) {
-		node_t *previous = first;
-		node_t *next_n = first->next;
-		int k = 1;	// the index where the new block should be found.
-
-		do {
-			block_t *prev_b = (block_t *)previous->data;
-			uint64_t prev_end = prev_b->start_address + prev_b->size - 1;
-			block_t *next_b = (block_t *)next_n->data;
-			uint64_t next_start = next_b->start_address;
-
-			// Verify if the new block is found between the current blocks.
-			if (prev_end < new_block->start_address &&
-				end_address_new < next_start) {
-				// Add the new block to the arena depending on whether it is
-				// adjacent to any already existing blocks or not.
-				cases_of_alloc_block(arena, k, prev_b, prev_end, next_b,
-									 next_start, new_block, end_address_new);
-				free(new_block);
-				return;
-			}
-			previous = previous->next;
-			next_n = next_n->next;
-			k++;
-		} while (next_n);
-	}
-	// Reach error only if a free zone is not found.
-	printf("This zone was already allocated.\n");
-	ll_free((list_t **)&new_block->miniblock_list);
-	free(new_block);
+	block_t new_block;
+	init_new_block(&new_block, address, size);
+	// The miniblock node never moves from now on, only its list changes.
+	node_t *minib_node = ((list_t *)new_block.miniblock_list)->head;
+	index_miniblock(arena, minib_node);
+	avl_node_t *block_node = cases_of_alloc_block(arena, prev_node, next_node,
+												  &new_block, end_address_new);
+	block_t *placed = (block_t *)block_node->data;  // merged with neighbours
+	snapshot_changed(arena, placed->start_address, placed->size);
+	radix_map(arena->radix, block_node, minib_node);
+	gaps_take(arena->gaps, address, size);
+	perms_allocated(arena, address, size);
+	arena->allocated_memory += size;
+	return VMA_OK;
 }
 
-// Eliminates a miniblock from the arena.
-void free_block(arena_t *arena, const uint64_t address)
+// Counts a change of the structure of the arena, so the snapshots taken before
+// it are not handed out anymore. The caller holds the tree lock alone.
+static void next_epoch(arena_t *arena)
 {
-	if (!arena || arena->alloc_list->total_elements == 0) {
-		printf("Invalid address for free.\n");
-		return;
-	}
-	unsigned int i;
-	block_t *curr_block = find_block(arena, address, &i);
-	if (!curr_block) {
-		printf("Invalid address for free.\n");	// No block was found.
-		return;
-	}
+	__atomic_store_n(&arena->epoch, arena->epoch + 1, __ATOMIC_RELEASE);
+}
 
-	list_t *minib_list = (list_t *)curr_block->miniblock_list;
-	node_t *minib_curr_node = minib_list->head;
-
-	for (unsigned int j = 0; j < minib_list->total_elements; j++) {
-		miniblock_t *minib_curr = (miniblock_t *)minib_curr_node->data;
-		if (minib_curr->start_address == address) {
-			// Miniblock to be freed is found.
-
-			// Case 1: The block has only one miniblock so we free it whole.
-			if (minib_list->total_elements == 1) {
-				ll_free(&minib_list);
-				free_node(arena->alloc_list, i);
-				return;
-			}
+// Create a block and add it in the tree of blocks from the arena or, if
+// adjacent to other previously existing blocks, concatenate it to other blocks.
+int alloc_block(arena_t *arena, const uint64_t address, const uint64_t size)
+{
+	uint64_t end_address_new = address + size - 1;
+	int status = alloc_block_errors(arena, address, end_address_new);
+	if (status != VMA_OK)
+		return status;
+
+	// The bytes of the new block are already zero, so only the structure of
+	// the arena changes.
+	lock_tree(arena->locks, 1);
+	status = place_block(arena, address, size);
+	if (status == VMA_OK)
+		next_epoch(arena);
+	unlock_tree(arena->locks);
+	return status;
+}
 
-			// Case 2: First or last miniblock in a list of miniblocks.
-			if (j == 0 || j == minib_list->total_elements - 1) {
-				// inceput sau end of block
-				if (j == 0)
-					curr_block->start_address += minib_curr->size;
-				curr_block->size -= minib_curr->size;
-				free_node(minib_list, j);
-				return;
-			}
+// Allocates a block of the given size without being told where: the free
+// zones of the arena give an address that is a multiple of "align"(a power of
+// two), chosen as "fit" says. "address" gets the start of the block.
+int alloc_auto(arena_t *arena, uint64_t size, uint64_t align, int fit,
+			   uint64_t *address)
+{
+	if (!arena)
+		return VMA_NO_ARENA;
+	if (!size)
+		return VMA_INVALID_SIZE;
+	if (!align || (align & (align - 1)))
+		return VMA_INVALID_ALIGNMENT;
+	if (fit < 0 || fit >= VMA_NR_FITS)
+		return VMA_INVALID_COMMAND;
+
+	lock_tree(arena->locks, 1);
+	int status = VMA_NO_FIT;
+	if (gaps_find(arena->gaps, size, align, fit, address))
+		status = place_block(arena, *address, size);
+	if (status == VMA_OK)
+		next_epoch(arena);
+	unlock_tree(arena->locks);
+	return status;
+}
 
-			// Case 3: The miniblock to be freed is somewhere in the middle.
-			// number of miniblock -> j, number of block -> i
-			minib_curr_node = minib_curr_node->next;  // To not lose the next.
+// Takes the miniblock starting at the given address out of its block and out
+// of the index. "size" gets its size.
+static int unlink_miniblock(arena_t *arena, uint64_t address, uint64_t *size)
+{
+	if (arena->alloc_tree->total_elements == 0)
+		return VMA_INVALID_FREE;
+	avl_node_t *block_node;
+	block_t *curr_block = find_block(arena, address, &block_node);
+	if (!curr_block)
+		return VMA_INVALID_FREE;  // No block was found.
+
+	// The miniblock to be freed has to start exactly at the given address.
+	node_t *minib_curr_node = find_miniblock(arena, address);
+	miniblock_t *minib_curr = (miniblock_t *)minib_curr_node->data;
+	if (minib_curr->start_address != address)
+		return VMA_INVALID_FREE;
 
-			curr_block->size -= minib_curr->size;  // Decrease the block size
-			free_node(minib_list, j);			   // Free miniblock to be freed
+	list_t *minib_list = (list_t *)curr_block->miniblock_list;
+	snapshot_changed(arena, curr_block->start_address, curr_block->size);
+	unindex_miniblock(arena, address);
+	tlb_flush(arena->tlb);
+	*size = minib_curr->size;
+	gaps_give(arena->gaps, address, *size);
+	perms_freed(arena, address, *size);
+	arena->allocated_memory -= *size;
+	radix_unmap(arena->radix, block_node, minib_curr_node);
+
+	// Case 1: The block has only one miniblock so we free it whole.
+	if (minib_list->total_elements == 1) {
+		ll_free(&minib_list);
+		avl_remove(arena->alloc_tree, block_node);
+		return VMA_OK;
+	}
 
-			// Create a new block with the miniblocks after the freed miniblock.
-			block_t *new_block = malloc(sizeof(block_t));
-			DIE(!new_block, "malloc failed");
-			new_block->size = 0;
+	// Case 2: First or last miniblock in a list of miniblocks.
+	if (!minib_curr_node->prev || !minib_curr_node->next) {
+		if (!minib_curr_node->prev) {
+			curr_block->start_address += minib_curr->size;
+			block_node->key = curr_block->start_address;
+		}
+		curr_block->size -= minib_curr->size;
+		ll_delete_node(minib_list, minib_curr_node);
+		return VMA_OK;
+	}
 
-			// First miniblock in the new block's miniblock list.
-			miniblock_t *new_minib = (miniblock_t *)minib_curr_node->data;
-			new_block->start_address = new_minib->start_address;
+	// Case 3: The miniblock to be freed is somewhere in the middle.
+	node_t *next = minib_curr_node->next;  // To not lose the next.
+	uint64_t end_block = curr_block->start_address + curr_block->size;
+
+	// Create a new block with the miniblocks after the freed miniblock. The
+	// blocks are contiguous, so the sizes follow from the addresses.
+	block_t new_block;
+	miniblock_t *new_minib = (miniblock_t *)next->data;
+	new_block.start_address = new_minib->start_address;
+	new_block.size = end_block - new_block.start_address;
+	curr_block->size = address - curr_block->start_address;
+
+	// The index tells how many miniblocks are in the new block, then the list
+	// is cut right after the freed miniblock.
+	unsigned int nr_moved = avl_rank(arena->minib_index, end_block) -
+							avl_rank(arena->minib_index,
+									 new_block.start_address);
+	ll_delete_node(minib_list, minib_curr_node);  // Free miniblock to be freed
+	new_block.miniblock_list = ll_split(minib_list, next, nr_moved);
+
+	// Add the new block to the tree of blocks.
+	avl_node_t *new_node = avl_insert(arena->alloc_tree,
+									  new_block.start_address, &new_block);
+	radix_rebind(arena->radix, new_block.start_address, new_block.size,
+				 new_node);
+	return VMA_OK;
+}
 
-			new_block->miniblock_list = ll_create(sizeof(miniblock_t));
-			list_t *new_minib_list = (list_t *)new_block->miniblock_list;
+// Eliminates a miniblock from the arena.
+int free_block(arena_t *arena, const uint64_t address)
+{
+	uint64_t size;
 
-			// Add the miniblocks after the freed miniblock to the new list.
-			node_t *next = minib_curr_node->next;
-			while (minib_list->total_elements - j) {  // j=freed miniblock's idx
-				ll_add_nth_node(new_minib_list, new_minib_list->total_elements,
-								minib_curr_node->data);
-				new_minib = (miniblock_t *)minib_curr_node->data;
-				new_block->size += new_minib->size;
-				free_node(minib_list, j);  // free the old node's memory
+	if (!arena)
+		return VMA_INVALID_FREE;
 
-				if (minib_list->total_elements - j == 0)
-					break;
-				minib_curr_node = next;
-				if (next->next)
-					next = next->next;
-			}
-			curr_block->size -= new_block->size;  // Update the old block's size
-			// Add the new block to the list of blocks.
-			ll_add_nth_node(arena->alloc_list, i + 1, new_block);
-			free(new_block);
-			return;
-		}
-		minib_curr_node = minib_curr_node->next;
+	lock_tree(arena->locks, 1);
+	int status = unlink_miniblock(arena, address, &size);
+	if (status != VMA_OK) {
+		unlock_tree(arena->locks);
+		return status;
 	}
-	printf("Invalid address for free.\n");
+	next_epoch(arena);
+
+	// The zone is no longer in the arena, so only the operations that were
+	// still using its bytes are waited for, and the structure is free again
+	// while the bytes are cleared.
+	lock_range(arena->locks, address, size, 1);
+	unlock_tree(arena->locks);
+	clear_memory(arena, address, size);
+	unlock_range(arena->locks, address, size);
+	return VMA_OK;
 }
 
-// Prints a given number of characters(size) starting from a certain given
-// address.
-void read(arena_t *arena, uint64_t address, uint64_t size)
+static int check_read(arena_t *arena, uint64_t address, uint64_t size,
+					  uint64_t *to_read)
 {
-	if (!arena || arena->alloc_list->total_elements == 0) {
-		printf("Invalid address for read.\n");
-		return;
-	}
+	if (arena->alloc_tree->total_elements == 0)
+		return VMA_INVALID_READ;
 
-	unsigned int i;
-	block_t *curr_block = find_block(arena, address, &i);
-	if (!curr_block) {
-		printf("Invalid address for read.\n");
-		return;
-	}
+	block_t *curr_block = find_block(arena, address, NULL);
+	if (!curr_block)
+		return VMA_INVALID_READ;
 
-	list_t *minib_list = (list_t *)curr_block->miniblock_list;
-	node_t *minib_curr_node = minib_list->head;	 // miniblock node
 	uint64_t end_block_curr = curr_block->start_address + curr_block->size - 1;
+	int status = VMA_OK;
+	*to_read = size;
 
-	for (unsigned int j = 0; j < minib_list->total_elements; j++) {
-		miniblock_t *minib_curr = (miniblock_t *)minib_curr_node->data;
-		uint64_t end_minib = minib_curr->start_address + minib_curr->size - 1;
-
-		if (minib_curr->start_address <= address && address <= end_minib) {
-			// Found first miniblock from which we read.
+	if (end_block_curr - address + 1 < size) {
+		*to_read = end_block_curr - address + 1;
+		status |= VMA_TRUNCATED;
+	}
 
-			if (end_block_curr - address + 1 < size) {
-				printf("Warning: size was bigger than the block size.");
-				size = end_block_curr - address + 1;
-				printf(" Reading %ld characters.\n", size);
-			}
+	if (!perms_check(arena, address, *to_read, 4))
+		status |= VMA_PERM_READ;
+	return status;
+}
 
-			if (!check_permission(minib_list, minib_curr_node, size, j, 4)) {
-				printf("Invalid permissions for read.\n");
-				return;
-			}
+// Checks whether "size" bytes can be read starting from a given address.
+// "to_read" gets how many of them are in the block: if there are less than
+// "size", the result also has the VMA_TRUNCATED flag.
+// If they can be read, the zone stays locked for reading until
+// "release_range" is called for it.
+int read_source(arena_t *arena, const uint64_t address, const uint64_t size,
+				uint64_t *to_read)
+{
+	*to_read = 0;
+	if (!arena)
+		return VMA_INVALID_READ;
 
-			unsigned int idx_total_read = 0;  // how many chars have been read
-
-			// Reading from the first miniblock(the current one).
-			if (minib_curr->start_address != address) {
-				unsigned int start = minib_curr->start_address;
-				unsigned int which_byte = 0;  // which byte in current miniblock
-
-				// Reach the address inside the miniblock where we should start
-				// reading from. (could be at the middle of a miniblock)
-				while (start != address) {
-					which_byte++;
-					start++;
-				}
-
-				char *data = (char *)minib_curr->rw_buffer;
-				while (which_byte < minib_curr->size && idx_total_read < size) {
-					printf("%c", data[which_byte]);
-					which_byte++;
-					idx_total_read++;
-				}
-				j++;
-			}
+	lock_tree(arena->locks, 0);
+	int status = check_read(arena, address, size, to_read);
+	if ((status & ~VMA_TRUNCATED) == VMA_OK) {
+		lock_range(arena->locks, address, *to_read, 0);
+		METRICS_ADD(metrics.bytes_read, *to_read);
+	}
+	unlock_tree(arena->locks);
+	return status;
+}
 
-			// Continue the reading from the following miniblocks.
-			for (unsigned int l = j; l < minib_list->total_elements; l++) {
-				unsigned int idx = 0;
-				char *data = (char *)minib_curr->rw_buffer;
-
-				while (idx < minib_curr->size && idx_total_read < size) {
-					printf("%c", data[idx]);
-					idx++;
-					idx_total_read++;
-				}
-				// Stop if there are no elements left or the size is reached.
-				if (l == minib_list->total_elements - 1 ||
-					idx_total_read == size)
-					break;
-				minib_curr_node = minib_curr_node->next;
-				minib_curr = (miniblock_t *)minib_curr_node->data;
-			}
-			printf("\n");
-			return;
+// Sends "size" bytes of the arena, starting from "address", to "out" as they
+// are(the zeroes too). The written pages next to each other go out with a
+// single call, the pages never written come from the zero page.
+void output_zone(const arena_t *arena, uint64_t address, uint64_t size,
+				 FILE *out)
+{
+	const uint8_t *run = NULL;
+	uint64_t run_len = 0, end = address + size;
+
+	while (address < end) {
+		uint64_t offset = address % VMA_PAGE_SIZE;
+		uint64_t segment = VMA_PAGE_SIZE - offset;
+		if (segment > end - address)
+			segment = end - address;
+		const uint8_t *src = page_data(arena, address / VMA_PAGE_SIZE) + offset;
+
+		if (run && run + run_len == src) {
+			run_len += segment;
+		} else {
+			if (run)
+				fwrite(run, 1, run_len, out);
+			run = src;
+			run_len = segment;
 		}
+		address += segment;
 	}
-	printf("Invalid address for read.\n");
+	if (run)
+		fwrite(run, 1, run_len, out);
 }
 
-// Creates the string of data that we will use in the write function.
-char *create_string(uint64_t size)
+// Prints the "size" bytes of the arena from the given address, without a
+// newline. The bytes that were written go out as they are(zeroes included),
+// with a call for each run of them; the bytes never written since their block
+// was allocated print nothing.
+void print_zone(const arena_t *arena, uint64_t address, uint64_t size,
+				FILE *out)
 {
-	// Get the remaining characters from the line we got the command from.
-	char *param = strtok(NULL, "\n");
-	int8_t *data = (int8_t *)param;
+	uint64_t end = address + size;
 
-	char *data_string = malloc(sizeof(char) * (size + 1));
-	DIE(!data_string, "malloc failed");
+	while (address < end) {
+		uint64_t run_end = written_run(arena, address, end, 1);
 
-	// If there are no other characters on the command line, we add the "new
-	// line" character that is actually the last character, but the strtok can't
-	// recognize it. Then, we add the string terminator.
-	if (!data) {
-		data_string[0] = '\n';
-		data_string[1] = '\0';
+		output_zone(arena, address, run_end - address, out);
+		address = written_run(arena, run_end, end, 0);
 	}
+}
 
-	if (data) {
-		// Copy the remaining characters from the command line to the data
-		// string.
-		for (unsigned int i = 0; i < strlen((char *)data); i++)
-			data_string[i] = (char)data[i];
+// Prints a given number of characters(size) starting from a certain given
+// address.
+void read(arena_t *arena, uint64_t address, uint64_t size, FILE *out)
+{
+	uint64_t to_read;
+	int status = read_source(arena, address, size, &to_read);
 
-		data_string[strlen((char *)data)] = '\0';
+	if (print_status(status, "Reading", to_read, out))
+		return;
+	print_zone(arena, address, to_read, out);
+	fputc('\n', out);
+	release_range(arena, address, to_read);
+}
 
-		unsigned int len = strlen(data_string);
-		// If the current string length is smaller with 1 char compared to the
-		// size we are looking for, it means we just reached an end of line so
-		// we add the "new line" character.
-		if (len == size - 1) {
-			data_string[len] = '\n';
-			data_string[len + 1] = '\0';
-		}
-	}
+// Unlocks a zone locked by "read_source" or "write_destination".
+void release_range(arena_t *arena, uint64_t address, uint64_t size)
+{
+	unlock_range(arena->locks, address, size);
+}
 
-	unsigned int len = strlen(data_string);
-	if (len < size) {
-		// If the first line contained other characters except from "\n", we
-		// make sure we add the "new line" char at the end, because we will have
-		// to read from the following lines in order to reach the given size.
-		if (data_string[0] != '\n') {
-			data_string[len] = '\n';
-			data_string[len + 1] = '\0';
-		}
-		len = strlen(data_string);
-		while (len < size) {
-			fscanf(stdin, "%c", &data_string[len]);
-			// every time we add a new character, we add the string terminator.
-			data_string[len + 1] = '\0';
-			len = strlen(data_string);
-		}
-	}
+// Copies "size" bytes to "dest", but only the ones before "to_write" (the
+// others are dropped). "done" bytes were copied before.
+static void keep_bytes(uint8_t *dest, uint64_t to_write, uint64_t done,
+					   const char *src, uint64_t size)
+{
+	if (done < to_write)
+		memcpy(dest + done, src, size < to_write - done ?
+										size : to_write - done);
+}
 
-	return data_string;
+// Reads the data of a WRITE command straight into the arena. The data could be
+// on more than one line: it is made of the rest of the command line("rest"),
+// the end of that line and then as many bytes from the input as needed to
+// reach "size". Any byte is allowed, even the string terminator.
+// Only the first "to_write" bytes go to "dest"(none if it is NULL, when the
+// write failed), the others are just consumed.
+void read_payload(input_t *in, const char *rest, uint64_t rest_len,
+				  uint8_t *dest, uint64_t to_write, uint64_t size)
+{
+	read_payload_from(in, rest, rest_len, 0, dest, to_write, size);
 }
 
-// Writes a number of characters in the miniblocks' buffers starting from a
-// given address.
-void write(arena_t *arena, const uint64_t address, const uint64_t size,
-		   int8_t *data)
+// Same as "read_payload", for data that begins "offset" bytes after the start
+// of the rest of the line(the data of the previous zones of a WRITEV was
+// already read).
+void read_payload_from(input_t *in, const char *rest, uint64_t rest_len,
+					   uint64_t offset, uint8_t *dest, uint64_t to_write,
+					   uint64_t size)
 {
-	if (!arena || arena->alloc_list->total_elements == 0) {
-		printf("Invalid address for write.\n");
-		free(data);
-		return;
-	}
+	uint64_t done = 0;
 
-	char *data_string = (char *)data;
+	if (!dest)
+		to_write = 0;
 
-	unsigned int i;
-	block_t *curr_block = find_block(arena, address, &i);
-	if (!curr_block) {
-		printf("Invalid address for write.\n");
-		free(data_string);
+	if (offset < rest_len) {
+		done = rest_len - offset < size ? rest_len - offset : size;
+		keep_bytes(dest, to_write, 0, rest + offset, done);
+	}
+	if (done == size)
 		return;
+
+	if (offset + done == rest_len) {
+		keep_bytes(dest, to_write, done, "\n", 1);
+		done++;
 	}
 
-	list_t *minib_list = (list_t *)curr_block->miniblock_list;
-	node_t *minib_curr_node = minib_list->head;	 // nod de minib
+	uint64_t kept = done < to_write ? to_write - done : 0;
+	input_read(in, kept ? dest + done : NULL, kept);
+	input_read(in, NULL, size - done - kept);
+}
+
+static int check_write(arena_t *arena, uint64_t address, uint64_t size,
+					   uint64_t *to_write)
+{
+	if (arena->alloc_tree->total_elements == 0)
+		return VMA_INVALID_WRITE;
+
+	block_t *curr_block = find_block(arena, address, NULL);
+	if (!curr_block)
+		return VMA_INVALID_WRITE;
+
 	uint64_t end_block_curr = curr_block->start_address + curr_block->size - 1;
+	int status = VMA_OK;
+	*to_write = size;
 
-	for (unsigned int j = 0; j < minib_list->total_elements; j++) {
-		miniblock_t *minib_curr = (miniblock_t *)minib_curr_node->data;
-		uint64_t end_mb_curr = minib_curr->start_address + minib_curr->size - 1;
-		if (minib_curr->start_address <= address && address <= end_mb_curr) {
-			// Miniblock found
+	if (end_block_curr - address + 1 < size) {
+		*to_write = end_block_curr - address + 1;
+		status |= VMA_TRUNCATED;
+	}
 
-			if (end_block_curr - address + 1 < size) {
-				printf("Warning: size was bigger than the block size.");
-				printf(" Writing %ld characters.\n",
-					   end_block_curr - address + 1);
-			}
+	if (!perms_check(arena, address, *to_write, 2))
+		return status | VMA_PERM_WRITE;
+	return status;
+}
 
-			if (!check_permission(minib_list, minib_curr_node, size, j, 2)) {
-				printf("Invalid permissions for write.\n");
-				return;
-			}
+// Checks whether "size" bytes can be written starting from a given address and
+// stores where they go in the arena in "dest"(NULL if they can't be written).
+// "to_write" gets how many of them fit in the block: if there are less than
+// "size", the result also has the VMA_TRUNCATED flag.
+// If they can be written, the zone stays locked for writing until
+// "release_range" is called for it.
+int write_destination(arena_t *arena, const uint64_t address,
+					  const uint64_t size, uint8_t **dest, uint64_t *to_write)
+{
+	*dest = NULL;
+	*to_write = 0;
+	if (!arena)
+		return VMA_INVALID_WRITE;
+
+	lock_tree(arena->locks, 0);
+	int status = check_write(arena, address, size, to_write);
+	if ((status & ~VMA_TRUNCATED) == VMA_OK) {
+		// The miniblocks of a block are contiguous in the arena, so the data
+		// goes in with a single copy. The system gives storage to the pages
+		// it touches.
+		lock_range(arena->locks, address, *to_write, 1);
+		mark_written(arena, address, *to_write);
+		METRICS_ADD(metrics.bytes_written, *to_write);
+		*dest = arena->base + address;
+	}
+	unlock_tree(arena->locks);
+	return status;
+}
 
-			unsigned int idx_data = 0;	// the index of the current char in data
-
-			for (uint64_t l = j; l < minib_list->total_elements; l++) {
-				unsigned int idx_minib = 0;	 // index of curr byte in miniblock
-				minib_curr->rw_buffer = malloc(minib_curr->size * sizeof(char));
-				DIE(!minib_curr->rw_buffer, "malloc failed");
-
-				while (idx_minib < minib_curr->size &&
-					   idx_data < strlen(data_string)) {
-					// Verify if there are enough characters left in data string
-					if (strlen(data_string) - idx_data < minib_curr->size) {
-						// Copy the remaining characters from data string.
-						memcpy(minib_curr->rw_buffer, data_string + idx_data,
-							   strlen(data_string) - idx_data);
-						idx_data += strlen(data_string) - idx_data;
-						idx_minib += strlen(data_string) - idx_data;
-					} else {
-						// Copy as many characters as the miniblock supports.
-						memcpy(minib_curr->rw_buffer, data_string + idx_data,
-							   minib_curr->size);
-						idx_data += minib_curr->size;
-						idx_minib += minib_curr->size;
-					}
-				}
-				if (l == minib_list->total_elements - 1)
-					break;
-				minib_curr_node = minib_curr_node->next;
-				minib_curr = (miniblock_t *)minib_curr_node->data;
-			}
-			free(data_string);
-			return;
+// Writes a number of characters in the arena starting from a given address.
+int write(arena_t *arena, const uint64_t address, const uint64_t size,
+		  const int8_t *data)
+{
+	uint64_t to_write;
+	uint8_t *dest;
+	int status = write_destination(arena, address, size, &dest, &to_write);
+
+	if (dest) {
+		memcpy(dest, data, to_write);
+		release_range(arena, address, to_write);
+	}
+	return status;
+}
+
+// Prints the blocks of a snapshot segment, each one followed in the array of
+// miniblocks by its own miniblocks. The blocks before it were "nr_printed".
+// Returns how many were printed with these.
+static uint64_t print_segment(const snap_segment_t *seg, uint64_t nr_printed,
+							  FILE *out)
+{
+	snap_minib_t *curr_miniblock = seg->miniblocks;
+	for (uint64_t i = 0; i < seg->nr_blocks; i++) {
+		snap_block_t *curr_block = &seg->blocks[i];
+		fprintf(out, "\nBlock %ld begin\n", nr_printed + i + 1);
+		fprintf(out, "Zone: 0x%lX - 0x%lX\n", curr_block->start_address,
+				curr_block->start_address + curr_block->size);
+
+		for (uint64_t j = 0; j < curr_block->nr_miniblocks; j++) {
+			fprintf(out, "Miniblock %ld:\t\t0x%lX\t\t-\t\t0x%lX\t\t| ",
+					j + 1, curr_miniblock->start_address,
+					curr_miniblock->start_address + curr_miniblock->size);
+			print_permissions(curr_miniblock->perm, out);
+			curr_miniblock++;
 		}
+		fprintf(out, "Block %ld end\n", nr_printed + i + 1);
 	}
-	free(data_string);
-	printf("Invalid address for write.\n");
+	return nr_printed + seg->nr_blocks;
 }
 
 // Print the details of the arena(memory, blocks, miniblocks)
-void pmap(const arena_t *arena)
+// verbose = 1 -> also print the memory reserved for the arena, how much of
+// it has storage of its own (the pages that were written) and the counters of
+// the translation cache.
+void pmap(arena_t *arena, int verbose, FILE *out)
 {
 	if (!arena)
 		return;
 
-	printf("Total memory: 0x%lX bytes\n", arena->arena_size);
+	// Everything is printed from a snapshot, so the arena can keep changing
+	// in the meantime.
+	snapshot_t *snap = take_snapshot(arena);
+
+	fprintf(out, "Total memory: 0x%lX bytes\n", snap->arena_size);
+	fprintf(out, "Free memory: 0x%lX bytes\n", snap->free_memory);
+	if (verbose) {
+		uint64_t nr_pages = (snap->arena_size + VMA_PAGE_SIZE - 1) /
+							VMA_PAGE_SIZE;
+		fprintf(out, "Reserved memory: 0x%lX bytes\n",
+				nr_pages * VMA_PAGE_SIZE);
+		fprintf(out, "Resident memory: 0x%lX bytes\n",
+				__atomic_load_n(&arena->nr_written_pages, __ATOMIC_RELAXED) *
+				VMA_PAGE_SIZE);
+		fprintf(out, "Translation cache: %lu entries, %lu hits, %lu misses\n",
+				arena->tlb->nr_entries, arena->tlb->hits, arena->tlb->misses);
+	}
+	fprintf(out, "Number of allocated blocks: %ld\n", snap->nr_blocks);
+	fprintf(out, "Number of allocated miniblocks: %ld\n", snap->nr_miniblocks);
 
-	uint64_t free_memory = arena->arena_size;
-	uint64_t nr_miniblocks = 0;
+	// The segments are in address order, and so are their blocks.
+	uint64_t nr_printed = 0;
+	for (uint64_t i = 0; i < snap->nr_segments; i++)
+		if (snap->segments[i])
+			nr_printed = print_segment(snap->segments[i], nr_printed, out);
 
-	// Find the number of miniblocks and free memory
-	node_t *curr_node_b = arena->alloc_list->head;
-	for (unsigned int i = 0; i < arena->alloc_list->total_elements; i++) {
-		block_t *curr_block = (block_t *)curr_node_b->data;
-		free_memory -= curr_block->size;
+	drop_snapshot(snap);
+}
 
-		list_t *miniblock_list = (list_t *)curr_block->miniblock_list;
-		nr_miniblocks += miniblock_list->total_elements;
+// Cuts the miniblock of the given node(in the block of "block_node") in two at
+// the address "at", if it falls inside it, and returns the node of the
+// miniblock starting at "at"(the given one if nothing was cut). Both halves
+// keep the permissions.
+static node_t *split_miniblock(arena_t *arena, avl_node_t *block_node,
+							   node_t *node, uint64_t at)
+{
+	miniblock_t *minib = (miniblock_t *)node->data;
 
-		curr_node_b = curr_node_b->next;
-	}
-	printf("Free memory: 0x%lX bytes\n", free_memory);
-	printf("Number of allocated blocks: %d\n",
-		   arena->alloc_list->total_elements);
-	printf("Number of allocated miniblocks: %ld\n", nr_miniblocks);
+	if (at <= minib->start_address || at >= minib->start_address + minib->size)
+		return node;
 
-	// Iterate through the list of blocks and then through each block's
-	// miniblock list and show details about each of them.
-	curr_node_b = arena->alloc_list->head;
-	for (unsigned int i = 0; i < arena->alloc_list->total_elements; i++) {
-		block_t *curr_block = (block_t *)curr_node_b->data;
-		list_t *miniblock_list = (list_t *)curr_block->miniblock_list;
-		printf("\nBlock %d begin\n", i + 1);
-		printf("Zone: 0x%lX - 0x%lX\n", curr_block->start_address,
-			   curr_block->start_address + curr_block->size);
+	miniblock_t second = *minib;
+	second.start_address = at;
+	second.size = minib->start_address + minib->size - at;
+	minib->size = at - minib->start_address;
 
-		node_t *curr_node_minib = miniblock_list->head;
-		for (unsigned int j = 0; j < miniblock_list->total_elements; j++) {
-			miniblock_t *curr_miniblock = (miniblock_t *)curr_node_minib->data;
+	list_t *list = (list_t *)((block_t *)block_node->data)->miniblock_list;
+	node_t *second_node = ll_add_after(list, node, &second);
+	index_miniblock(arena, second_node);
+	radix_map(arena->radix, block_node, second_node);
+	return second_node;
+}
 
-			printf("Miniblock %d:\t\t0x%lX\t\t-\t\t0x%lX\t\t| ", j + 1,
-				   curr_miniblock->start_address,
-				   curr_miniblock->start_address + curr_miniblock->size);
-			print_permissions(curr_miniblock->perm);
+// Reads the counters of the arena. The number of blocks and of miniblocks are
+// the sizes of their trees and the largest free zone is at the root of the
+// index of free zones, so nothing is walked.
+int arena_stats(arena_t *arena, arena_stats_t *stats)
+{
+	if (!arena)
+		return VMA_NO_ARENA;
+
+	lock_tree(arena->locks, 0);
+	avl_node_t *root = arena->gaps->by_address->root;
+	stats->total_memory = arena->arena_size;
+	stats->allocated_memory = arena->allocated_memory;
+	stats->free_memory = arena->arena_size - arena->allocated_memory;
+	stats->nr_blocks = avl_get_size(arena->alloc_tree);
+	stats->nr_miniblocks = avl_get_size(arena->minib_index);
+	stats->largest_free_zone = root ? root->max_value : 0;
+	stats->resident_memory = __atomic_load_n(&arena->nr_written_pages,
+											 __ATOMIC_RELAXED) * VMA_PAGE_SIZE;
+	stats->written_memory = __atomic_load_n(&arena->nr_written_bytes,
+											__ATOMIC_RELAXED);
+	unlock_tree(arena->locks);
+	return VMA_OK;
+}
 
-			curr_node_minib = curr_node_minib->next;
-		}
-		printf("Block %d end\n", i + 1);
-		curr_node_b = curr_node_b->next;
+// Prints the counters of the arena(the header of PMAP and a bit more, without
+// the blocks).
+void print_stats(arena_t *arena, FILE *out)
+{
+	arena_stats_t stats;
+
+	if (print_status(arena_stats(arena, &stats), NULL, 0, out))
+		return;
+	fprintf(out, "Total memory: 0x%lX bytes\n", stats.total_memory);
+	fprintf(out, "Allocated memory: 0x%lX bytes\n", stats.allocated_memory);
+	fprintf(out, "Free memory: 0x%lX bytes\n", stats.free_memory);
+	fprintf(out, "Largest free zone: 0x%lX bytes\n", stats.largest_free_zone);
+	fprintf(out, "Resident memory: 0x%lX bytes\n", stats.resident_memory);
+	fprintf(out, "Written memory: 0x%lX bytes\n", stats.written_memory);
+	fprintf(out, "Number of allocated blocks: %ld\n", stats.nr_blocks);
+	fprintf(out, "Number of allocated miniblocks: %ld\n", stats.nr_miniblocks);
+}
+
+// Changes the permissions of a certain miniblock(4 read, 2 write, 1 execute).
+int mprotect(arena_t *arena, uint64_t address, uint8_t perm)
+{
+	if (!arena)
+		return VMA_INVALID_MPROTECT;
+
+	lock_tree(arena->locks, 1);
+	node_t *minib_curr_node = find_miniblock(arena, address);
+	miniblock_t *minib_curr = minib_curr_node ?
+							  (miniblock_t *)minib_curr_node->data : NULL;
+	if (!minib_curr || minib_curr->start_address != address) {
+		unlock_tree(arena->locks);
+		return VMA_INVALID_MPROTECT;
 	}
+
+	// Found the miniblock from the given address.
+	// Change the miniblock's permission to the new one.
+	minib_curr->perm = perm;
+	perms_changed(arena, address, minib_curr->size, perm);
+	snapshot_changed(arena, address, minib_curr->size);
+	next_epoch(arena);
+	unlock_tree(arena->locks);
+	return VMA_OK;
 }
 
-// Changes the permissions of a certain miniblock.
-void mprotect(arena_t *arena, uint64_t address, int8_t *permission)
+// Changes the permissions of the "size" bytes from a page-aligned address, like
+// mprotect(2): they must all be allocated(so in a single block). The
+// miniblocks crossing the borders of the zone are cut there, so every
+// miniblock is either inside the zone or outside it.
+int mprotect_range(arena_t *arena, uint64_t address, uint64_t size,
+				   uint8_t perm)
 {
-	int8_t perm = find_permission(permission);
-	unsigned int i;
-	block_t *curr_block = find_block(arena, address, &i);
-	if (!curr_block) {
-		printf("Invalid address for mprotect.\n");
-		return;
+	if (!arena || address % VMA_PAGE_SIZE || !size)
+		return VMA_INVALID_MPROTECT;
+
+	lock_tree(arena->locks, 1);
+	avl_node_t *block_node;
+	block_t *block = find_block(arena, address, &block_node);
+	if (!block || size > block->start_address + block->size - address) {
+		unlock_tree(arena->locks);
+		return VMA_INVALID_MPROTECT;
 	}
 
-	list_t *minib_list = (list_t *)curr_block->miniblock_list;
-	node_t *minib_curr_node = minib_list->head;
-
-	for (unsigned int j = 0; j < minib_list->total_elements; j++) {
-		miniblock_t *minib_curr = (miniblock_t *)minib_curr_node->data;
-		if (minib_curr->start_address == address) {
-			// Found the miniblock from the given address.
-			// Change the miniblock's permission to the new one.
-			minib_curr->perm = perm;
-			return;
-		}
-		minib_curr_node = minib_curr_node->next;
+	uint64_t end = address + size;
+	node_t *first = split_miniblock(arena, block_node,
+									find_miniblock(arena, address), address);
+	split_miniblock(arena, block_node, find_miniblock(arena, end - 1), end);
+
+	for (node_t *curr = first; curr; curr = curr->next) {
+		miniblock_t *minib = (miniblock_t *)curr->data;
+		if (minib->start_address >= end)
+			break;
+		minib->perm = perm;
 	}
-	printf("Invalid address for mprotect.\n");
+	perms_changed(arena, address, size, perm);
+	snapshot_changed(arena, block->start_address, block->size);
+	next_epoch(arena);
+	unlock_tree(arena->locks);
+	return VMA_OK;
 }
 
 // Transforms the string parameters of the MPROTECT command into a number in
@@ -686,52 +1182,158 @@ int find_permission(int8_t *permission)
 	return final_permission;
 }
 
+// The entry of the translation cache for an address(NULL if the arena doesn't
+// use the cache).
+static tlb_entry_t *cache_slot(arena_t *arena, uint64_t address)
+{
+	return arena->locks ? NULL : tlb_slot(arena->tlb, address);
+}
+
+// Finds the tree node of the block holding the address, without the cache.
+static avl_node_t *lookup_block(arena_t *arena, uint64_t address)
+{
+	// With a page table, only the miniblocks of the page are looked at. An
+	// address past the arena has no page of its own.
+	if (arena->radix) {
+		avl_node_t *block;
+		if (address >= arena->arena_size)
+			return NULL;
+		radix_lookup(arena->radix, address, &block);
+		return block;
+	}
+
+	uint64_t steps = METRICS_STEPS();
+	avl_node_t *curr = avl_floor(arena->alloc_tree, address);	// block node
+	METRICS_ADD(metrics.block_steps, METRICS_STEPS() - steps);
+	if (!curr)
+		return NULL;
+
+	block_t *curr_block = (block_t *)curr->data;  // block
+	uint64_t curr_ending = curr_block->start_address + curr_block->size - 1;
+
+	// Verify if the address is found somewhere in that block.
+	if (address > curr_ending)
+		return NULL;
+	return curr;
+}
+
+// Finds the list node of the miniblock holding the address, without the cache.
+static node_t *lookup_miniblock(arena_t *arena, uint64_t address)
+{
+	avl_node_t *block;
+
+	if (arena->radix)
+		return address < arena->arena_size ?
+			   radix_lookup(arena->radix, address, &block) : NULL;
+
+	uint64_t steps = METRICS_STEPS();
+	avl_node_t *entry = avl_floor(arena->minib_index, address);
+	METRICS_ADD(metrics.minib_steps, METRICS_STEPS() - steps);
+	if (!entry)
+		return NULL;
+
+	node_t *minib_node = *(node_t **)entry->data;
+	miniblock_t *minib = (miniblock_t *)minib_node->data;
+	if (address > minib->start_address + minib->size - 1)
+		return NULL;
+	return minib_node;
+}
+
 // Finds whether there is an allocated block at a given address and returns its
 // address if found.
-// idx's address is given as parameter in order to change its value -> of great
-// use in the free_block function.
-block_t *find_block(arena_t *arena, const uint64_t address, unsigned int *idx)
-{
-	node_t *curr = arena->alloc_list->head;	 // block node
-	for (unsigned int i = 0; i < arena->alloc_list->total_elements; i++) {
-		block_t *curr_block = (block_t *)curr->data;  // block
-		uint64_t curr_ending = curr_block->start_address + curr_block->size - 1;
-
-		// Verify if the address is found somewhere in that block.
-		if (curr_block->start_address <= address && address <= curr_ending) {
-			*idx = i;
-			return curr_block;
+// The only candidate is the last block starting at or before the address. Its
+// tree node is stored in "node" (if not NULL) -> of great use in the
+// free_block function.
+block_t *find_block(arena_t *arena, const uint64_t address,
+					avl_node_t **node)
+{
+	// The cached block of the page is taken if it still holds the address.
+	tlb_entry_t *slot = cache_slot(arena, address);
+	avl_node_t *curr = slot ? slot->block : NULL;
+	block_t *curr_block = curr ? (block_t *)curr->data : NULL;
+
+	METRICS_ADD(metrics.block_lookups, 1);
+	if (curr_block && address >= curr_block->start_address &&
+		address - curr_block->start_address < curr_block->size) {
+		arena->tlb->hits++;
+	} else {
+		curr = lookup_block(arena, address);
+		if (slot) {
+			arena->tlb->misses++;
+			slot->block = curr;
 		}
-		curr = curr->next;
+		if (!curr)
+			return NULL;
+		curr_block = (block_t *)curr->data;
+	}
+
+	if (node)
+		*node = curr;
+	return curr_block;
+}
+
+// Finds the miniblock that contains the given address through the miniblock
+// index and returns its list node (NULL if the address is not allocated).
+node_t *find_miniblock(arena_t *arena, const uint64_t address)
+{
+	tlb_entry_t *slot = cache_slot(arena, address);
+	node_t *minib_node = slot ? slot->minib : NULL;
+	miniblock_t *minib = minib_node ? (miniblock_t *)minib_node->data : NULL;
+
+	METRICS_ADD(metrics.minib_lookups, 1);
+	if (minib && address >= minib->start_address &&
+		address - minib->start_address < minib->size) {
+		arena->tlb->hits++;
+		return minib_node;
 	}
-	return NULL;
+
+	minib_node = lookup_miniblock(arena, address);
+	if (slot) {
+		arena->tlb->misses++;
+		slot->minib = minib_node;
+	}
+	return minib_node;
+}
+
+// Adds the miniblock held by "minib_node" to the index. The nodes are only
+// relinked between lists, never copied, so the entry stays valid until the
+// miniblock is freed.
+void index_miniblock(arena_t *arena, node_t *minib_node)
+{
+	miniblock_t *minib = (miniblock_t *)minib_node->data;
+
+	avl_insert(arena->minib_index, minib->start_address, &minib_node);
+}
+
+// Removes the miniblock starting at the given address from the index.
+void unindex_miniblock(arena_t *arena, const uint64_t address)
+{
+	avl_node_t *entry = avl_floor(arena->minib_index, address);
+
+	if (entry && entry->key == address)
+		avl_remove(arena->minib_index, entry);
 }
 
-// Verifies if we have permissions to do a certain action on a series of
-// miniblocks starting from a given miniblock until we reach a given size.
+// Verifies if we have permissions to do a certain action on the "size" bytes
+// starting from a given address, found in the given miniblock and the ones
+// after it. Only the miniblocks holding those bytes are looked at.
 // mode = 4 -> READ; mode = 2 -> WRITE
-int check_permission(list_t *minib_list, node_t *minib_node, uint64_t size,
-					 int j, int mode)
+int check_permission(node_t *minib_node, uint64_t address, uint64_t size,
+					 int mode)
 {
 	uint64_t mask = mode;
+	uint64_t end = address + size;
 
-	node_t *minib_curr_node = minib_node;
-	miniblock_t *minib_curr = (miniblock_t *)minib_curr_node->data;
-	unsigned int idx_data = 0;
-
-	for (unsigned int l = j; l < minib_list->total_elements || idx_data < size;
-		 l++) {
-		idx_data += minib_curr->size;
+	for (node_t *curr = minib_node; curr; curr = curr->next) {
+		miniblock_t *minib_curr = (miniblock_t *)curr->data;
+		if (minib_curr->start_address >= end)
+			break;
+		METRICS_ADD(metrics.minib_steps, 1);
 
 		// Verify if we have the permission to do the given action on the
 		// current miniblock through bitwise operations (bitwise AND).
 		if ((minib_curr->perm & mask) == 0)
 			return 0;
-
-		if (l == minib_list->total_elements - 1)
-			break;
-		minib_curr_node = minib_curr_node->next;
-		minib_curr = (miniblock_t *)minib_curr_node->data;
 	}
 
 	// All the miniblocks verify the permissions.
@@ -740,73 +1342,247 @@ int check_permission(list_t *minib_list, node_t *minib_node, uint64_t size,
 
 // Prints the permissions of a certain miniblock. Uses bitwise
 // operations(bitwise AND)
-void print_permissions(uint8_t permissions)
+void print_permissions(uint8_t permissions, FILE *out)
 {
 	if ((permissions & 4) != 0)
-		printf("R");
+		fprintf(out, "R");
 	else
-		printf("-");
+		fprintf(out, "-");
 	if ((permissions & 2) != 0)
-		printf("W");
+		fprintf(out, "W");
 	else
-		printf("-");
+		fprintf(out, "-");
 	if ((permissions & 1) != 0)
-		printf("X");
+		fprintf(out, "X");
 	else
-		printf("-");
-	printf("\n");
+		fprintf(out, "-");
+	fprintf(out, "\n");
 }
 
 // ===================
 // AUXILIARY FUNCTIONS
 // ===================
 
+// Splits a line into words(separated by spaces) in a single pass, without
+// copying it. All the words are counted, but only the first MAX_WORDS are kept,
+// as no command needs more. A first word like "@3" is not counted: it gives
+// the handle of the arena the command is for(0 if it is missing).
+void parse_command(char *line, size_t len, command_t *cmd)
+{
+	char *end = line + len;
+	char *curr = line;
+
+	cmd->nr_param = 0;
+	cmd->arena = 0;
+	cmd->has_arena = 0;
+	while (curr < end && *curr == ' ')
+		curr++;
+	if (curr < end && *curr == '@') {
+		char *handle = ++curr;
+		while (curr < end && *curr != ' ')
+			curr++;
+		cmd->arena = parse_number(handle, curr - handle);
+		cmd->has_arena = 1;
+	}
+
+	while (1) {
+		while (curr < end && *curr == ' ')
+			curr++;
+		if (curr == end)
+			break;
+
+		char *word = curr;
+		while (curr < end && *curr != ' ')
+			curr++;
+
+		if (cmd->nr_param < MAX_WORDS) {
+			cmd->word[cmd->nr_param] = word;
+			cmd->word_len[cmd->nr_param] = curr - word;
+		}
+		cmd->nr_param++;
+	}
+
+	cmd->type = 0;
+	if (cmd->nr_param)
+		cmd->type = command_type(cmd->word[0], cmd->word_len[0]);
+}
+
 // Translates the string commands into numbers so we will be able to use switch
-// case.
-int command_type(char *command)
+// case. The length alone tells most commands apart, so at most four
+// comparisons are made.
+int command_type(const char *command, size_t len)
 {
-	if (strcmp(command, "ALLOC_ARENA") == 0)
-		return 1;
-	if (strcmp(command, "DEALLOC_ARENA") == 0)
-		return 2;
-	if (strcmp(command, "ALLOC_BLOCK") == 0)
-		return 3;
-	if (strcmp(command, "FREE_BLOCK") == 0)
-		return 4;
-	if (strcmp(command, "READ") == 0)
-		return 5;
-	if (strcmp(command, "WRITE") == 0)
-		return 6;
-	if (strcmp(command, "PMAP") == 0)
-		return 7;
-	if (strcmp(command, "MPROTECT") == 0)
-		return 8;
+	switch (len) {
+		case 4:
+			if (memcmp(command, "READ", 4) == 0)
+				return 5;
+			if (memcmp(command, "PMAP", 4) == 0)
+				return 7;
+			if (memcmp(command, "SAVE", 4) == 0)
+				return 11;
+			if (memcmp(command, "LOAD", 4) == 0)
+				return 12;
+			break;
+		case 5:
+			if (memcmp(command, "WRITE", 5) == 0)
+				return 6;
+			if (memcmp(command, "STATS", 5) == 0)
+				return 10;
+			if (memcmp(command, "READV", 5) == 0)
+				return 17;
+			break;
+		case 6:
+			if (memcmp(command, "MEMSET", 6) == 0)
+				return 13;
+			if (memcmp(command, "MEMCPY", 6) == 0)
+				return 14;
+			if (memcmp(command, "MEMCMP", 6) == 0)
+				return 16;
+			if (memcmp(command, "WRITEV", 6) == 0)
+				return 18;
+			break;
+		case 7:
+			if (memcmp(command, "MEMMOVE", 7) == 0)
+				return 15;
+			break;
+		case 8:
+			if (memcmp(command, "MPROTECT", 8) == 0)
+				return 8;
+			break;
+		case 10:
+			if (memcmp(command, "FREE_BLOCK", 10) == 0)
+				return 4;
+			if (memcmp(command, "ALLOC_AUTO", 10) == 0)
+				return 9;
+			break;
+		case 11:
+			if (memcmp(command, "ALLOC_ARENA", 11) == 0)
+				return 1;
+			if (memcmp(command, "ALLOC_BLOCK", 11) == 0)
+				return 3;
+			break;
+		case 13:
+			if (memcmp(command, "DEALLOC_ARENA", 13) == 0)
+				return 2;
+			break;
+	}
 	return 0;
 }
 
-// Determines the number of words on a line. This will help us to check if there
-// are enough parameters for a certain command.
-int nr_of_parameters(char *line, char *delim)
+// Translates the name of a placement policy(the last word of ALLOC_AUTO).
+// Returns -1 for an unknown one.
+int fit_type(const char *word, size_t len)
 {
-	int nr = 0;
-	char *word = strtok(line, delim);
+	if (len == 9 && memcmp(word, "FIRST_FIT", 9) == 0)
+		return VMA_FIRST_FIT;
+	if (len == 8 && memcmp(word, "BEST_FIT", 8) == 0)
+		return VMA_BEST_FIT;
+	if (len == 8 && memcmp(word, "NEXT_FIT", 8) == 0)
+		return VMA_NEXT_FIT;
+	return -1;
+}
 
-	while (word) {
-		nr++;
-		word = strtok(NULL, delim);
+// Translates the name of an engine(the last word of ALLOC_ARENA). Returns -1
+// for an unknown one.
+int engine_type(const char *word, size_t len)
+{
+	if (len == 4 && memcmp(word, "TREE", 4) == 0)
+		return VMA_ENGINE_TREE;
+	if (len == 5 && memcmp(word, "RADIX", 5) == 0)
+		return VMA_ENGINE_RADIX;
+	return -1;
+}
+
+// Converts a word into a number, like "atol" does(an optional sign, then the
+// digits up to the first character that isn't one), but also accepts
+// hexadecimal numbers written with the "0x" prefix.
+uint64_t parse_number(const char *word, size_t len)
+{
+	const char *end = word + len;
+	uint64_t number = 0;
+	int negative = 0;
+
+	if (word < end && (*word == '-' || *word == '+')) {
+		negative = *word == '-';
+		word++;
+	}
+
+	if (end - word > 2 && word[0] == '0' && (word[1] | 0x20) == 'x') {
+		for (word += 2; word < end; word++) {
+			unsigned int digit = (unsigned int)(*word - '0');
+			if (digit >= 10) {
+				digit = (unsigned int)((*word | 0x20) - 'a');
+				if (digit >= 6)
+					break;
+				digit += 10;
+			}
+			number = number * 16 + digit;
+		}
+	} else {
+		for (; word < end && (unsigned int)(*word - '0') < 10; word++)
+			number = number * 10 + (*word - '0');
 	}
 
-	return nr;
+	return negative ? -number : number;
+}
+
+// Returns the numeric value of the word "idx" of a command.
+uint64_t command_number(const command_t *cmd, int idx)
+{
+	return parse_number(cmd->word[idx], cmd->word_len[idx]);
+}
+
+// The messages of the text protocol for the results of the operations.
+static const char *const status_messages[VMA_NR_STATUSES] = {
+	[VMA_NO_ARENA] = "Arena was not allocated.",
+	[VMA_ADDRESS_OUTSIDE] =
+		"The allocated address is outside the size of arena",
+	[VMA_END_OUTSIDE] = "The end address is past the size of the arena",
+	[VMA_ZONE_ALLOCATED] = "This zone was already allocated.",
+	[VMA_INVALID_FREE] = "Invalid address for free.",
+	[VMA_INVALID_READ] = "Invalid address for read.",
+	[VMA_PERM_READ] = "Invalid permissions for read.",
+	[VMA_INVALID_WRITE] = "Invalid address for write.",
+	[VMA_PERM_WRITE] = "Invalid permissions for write.",
+	[VMA_INVALID_MPROTECT] = "Invalid address for mprotect.",
+	[VMA_INVALID_COMMAND] = "Invalid command. Please try again.",
+	[VMA_INVALID_HANDLE] = "Invalid arena handle.",
+	[VMA_INVALID_SIZE] = "Invalid size for alloc.",
+	[VMA_INVALID_ALIGNMENT] = "Invalid alignment.",
+	[VMA_NO_FIT] = "No free zone is big enough.",
+	[VMA_INVALID_ENGINE] = "Invalid engine for the arena.",
+	[VMA_FILE_ERROR] = "Could not access the file.",
+	[VMA_INVALID_CHECKPOINT] = "Invalid checkpoint file.",
+	[VMA_OVERLAP] = "The zones overlap, use MEMMOVE.",
+};
+
+// Prints the messages for the result of an operation: first the warning, if
+// the size was cut to "size" bytes("action" says what was done with them),
+// then the error, if any. Returns 1 if there was an error.
+int print_status(int status, const char *action, uint64_t size, FILE *out)
+{
+	metrics_status(status);
+	if (status & VMA_TRUNCATED) {
+		fprintf(out, "Warning: size was bigger than the block size.");
+		fprintf(out, " %s %ld characters.\n", action, size);
+	}
+
+	status &= ~VMA_TRUNCATED;
+	if (status == VMA_OK)
+		return 0;
+	fprintf(out, "%s\n", status_messages[status]);
+	return 1;
 }
 
 // Verifies whether a command has the necessary amount of parameters.
 // If not, we print an error for each parameter.
-int check_parameters(int type, int nr_param)
+int check_parameters(int type, int nr_param, FILE *out)
 {
 	int ok = 1;
 	if (type == 0)
 		ok = 0;
-	if (type == 1 && nr_param != 2)	 // ALLOC_ARENA + size
+	// ALLOC_ARENA + size [+ engine]
+	if (type == 1 && nr_param != 2 && nr_param != 3)
 		ok = 0;
 	if (type == 2 && nr_param != 1)	 // DEALLOC_ARENA
 		ok = 0;
@@ -821,14 +1597,33 @@ int check_parameters(int type, int nr_param)
 	if (type == 6 && nr_param < 3)	// WRITE + address + size + data
 		ok = 0;
 
-	if (type == 7 && nr_param != 1)	 // PMAP
+	if (type == 7 && nr_param != 1 && nr_param != 2)  // PMAP [-v]
 		ok = 0;
 
 	if (type == 8 && nr_param < 3)	// MPROTECT + address + new_permissions
 		ok = 0;
 
+	// ALLOC_AUTO + size [+ alignment [+ policy]]
+	if (type == 9 && (nr_param < 2 || nr_param > 4))
+		ok = 0;
+
+	if (type == 10 && nr_param != 1 && nr_param != 2)  // STATS [-c]
+		ok = 0;
+
+	if ((type == 11 || type == 12) && nr_param != 2)  // SAVE, LOAD + file
+		ok = 0;
+
+	// MEMSET + address + size + byte; MEMCPY, MEMMOVE + destination + source
+	// + size; MEMCMP + address + address + size
+	if (type >= 13 && type <= 16 && nr_param != 4)
+		ok = 0;
+
+	// READV, WRITEV + count + count * (address + size) [+ data]
+	if ((type == 17 || type == 18) && nr_param < 4)
+		ok = 0;
+
 	if (ok == 0)
 		for (int i = 0; i < nr_param; i++)
-			printf("Invalid command. Please try again.\n");
+			print_status(VMA_INVALID_COMMAND, NULL, 0, out);
 	return ok;
 }
@@ -7,7 +7,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "avl.h"
+#include "input.h"
 #include "list.h"
+#include "locks.h"
+
+#define VMA_PAGE_SIZE 4096UL
+#define VMA_DEFAULT_PERM 6	// RW-, the permissions of a new miniblock
 
 #define DIE(assertion, call_description)                       \
 	do {                                                       \
@@ -24,48 +30,189 @@ typedef struct {
 	void *miniblock_list;
 } block_t;
 
+// The bytes of a miniblock are found at "base + start_address" in its arena.
+// The permissions share a word with the size: a miniblock can't be bigger than
+// its arena, which has to fit in the address space(well under 2^56 bytes).
 typedef struct {
 	uint64_t start_address;
-	size_t size;
-	uint8_t perm;
-	void *rw_buffer;
+	uint64_t size : 56;
+	uint64_t perm : 8;
 } miniblock_t;
 
 typedef struct {
 	uint64_t arena_size;
-	list_t *alloc_list;
+	uint8_t *base;	// the bytes of the whole arena, reserved at once
+	uint8_t *written_pages;	 // bitmap: the pages with storage of their own
+	uint64_t nr_written_pages;
+	uint8_t *written_bytes;	 // bitmap: the bytes READ prints
+	uint64_t nr_written_bytes;	// the bits set in "written_bytes"
+	uint64_t allocated_memory;	// the bytes of all the blocks
+	uint8_t *page_perms;  // the permissions of each page(see "perms.h")
+	uint8_t file_backed;  // some pages are mapped from a checkpoint
+	avl_t *alloc_tree;	// blocks ordered by their start address
+	avl_t *minib_index;	// list nodes of all the miniblocks, by address
+	arena_locks_t *locks;  // NULL unless the arena is concurrent
+	uint64_t epoch;	 // changes of the structure so far
+	struct snapshot *snapshot;	// the last one taken(concurrent mode)
+	uint8_t *snap_dirty;  // bitmap: the segments it misses(see "snapshot.h")
+	struct gap_index *gaps;	 // the free zones, for ALLOC_AUTO
+	struct radix *radix;  // NULL unless the arena has a page table
+	struct tlb *tlb;  // the translation cache(see "tlb.h")
 } arena_t;
 
+// The counters of an arena(STATS), all of them kept up to date by the
+// operations, so reading them doesn't walk anything.
+typedef struct {
+	uint64_t total_memory;
+	uint64_t allocated_memory;
+	uint64_t free_memory;
+	uint64_t nr_blocks;
+	uint64_t nr_miniblocks;
+	uint64_t largest_free_zone;
+	uint64_t resident_memory;  // the bytes of the written pages
+	uint64_t written_memory;  // the bytes written since their block came
+} arena_stats_t;
+
+// How the addresses of an arena are translated to blocks and miniblocks.
+enum {
+	VMA_ENGINE_TREE,  // the tree of blocks and the miniblock index
+	VMA_ENGINE_RADIX,  // a page table first(see "radix.h"), then the trees
+	VMA_NR_ENGINES
+};
+
+// Results of the operations on an arena. The text driver prints a message for
+// each of them("print_status"), the binary one sends them as they are.
+enum {
+	VMA_OK,
+	VMA_NO_ARENA,
+	VMA_ADDRESS_OUTSIDE,
+	VMA_END_OUTSIDE,
+	VMA_ZONE_ALLOCATED,
+	VMA_INVALID_FREE,
+	VMA_INVALID_READ,
+	VMA_PERM_READ,
+	VMA_INVALID_WRITE,
+	VMA_PERM_WRITE,
+	VMA_INVALID_MPROTECT,
+	VMA_INVALID_COMMAND,
+	VMA_INVALID_HANDLE,
+	VMA_INVALID_SIZE,
+	VMA_INVALID_ALIGNMENT,
+	VMA_NO_FIT,
+	VMA_INVALID_ENGINE,
+	VMA_FILE_ERROR,
+	VMA_INVALID_CHECKPOINT,
+	VMA_OVERLAP,
+	VMA_NR_STATUSES
+};
+
+// Added to the result of a READ or a WRITE when the size was cut to the end of
+// the block(it is only a warning, the operation can still fail or succeed).
+#define VMA_TRUNCATED 0x80
+
+#define MAX_WORDS 4	 // words of a command line kept by "parse_command"
+
+// A command line split into words in place: the words are neither copied nor
+// terminated, they are only pointed at.
+typedef struct {
+	int type;
+	uint64_t arena;	 // the handle of the arena
+	int has_arena;	 // whether the handle was given
+	int nr_param;  // words on the line, the command included
+	char *word[MAX_WORDS];
+	size_t word_len[MAX_WORDS];
+} command_t;
+
+#define VMA_MAX_ARENAS (1U << 20)  // the handles are smaller than this
+
+// The arenas of a process, by handle. The table grows to fit the biggest
+// handle given so far.
+typedef struct {
+	arena_t **arenas;  // NULL for the handles with no arena
+	uint32_t capacity;
+	uint32_t nr_arenas;
+	int engine;	 // for the arenas created without one
+} arena_table_t;
+
 arena_t *alloc_arena(const uint64_t size);
-void free_buffers(list_t *minib_list);
+void make_concurrent(arena_t *arena);
+int make_radix(arena_t *arena);
+uint64_t bitmap_size(uint64_t arena_size);
+void clear_memory(arena_t *arena, uint64_t address, uint64_t size);
+int page_written(const arena_t *arena, uint64_t page);
+void mark_pages_written(arena_t *arena, uint64_t address, uint64_t size);
+void set_written(arena_t *arena, uint64_t address, uint64_t size, int written);
+int byte_written(const arena_t *arena, uint64_t address);
+uint64_t count_written(const arena_t *arena, uint64_t first, uint64_t len);
+uint64_t written_run(const arena_t *arena, uint64_t address, uint64_t end,
+					 int written);
+void mark_written(arena_t *arena, uint64_t address, uint64_t size);
+const uint8_t *page_data(const arena_t *arena, uint64_t page);
+void copy_bytes(const arena_t *arena, uint64_t address, uint64_t size,
+				uint8_t *dest);
 void dealloc_arena(arena_t *arena);
 
+void arenas_init(arena_table_t *table);
+arena_t *get_arena(const arena_table_t *table, uint64_t handle);
+int create_arena(arena_table_t *table, uint64_t handle, uint64_t size,
+				 int engine);
+int load_arena(arena_table_t *table, uint64_t handle, const char *path);
+int destroy_arena(arena_table_t *table, uint64_t handle);
+void destroy_all_arenas(arena_table_t *table);
+
 void concat_block(block_t *old_block, block_t *new_block, int idx);
 int alloc_block_errors(arena_t *arena, uint64_t address, uint64_t end_addr_new);
-void cases_of_alloc_block(arena_t *arena, int k, block_t *prev_b,
-						  uint64_t prev_end, block_t *next_b,
-						  uint64_t next_start, block_t *new_block,
-						  uint64_t end_address_new);
-block_t *init_new_block(uint64_t address, uint64_t size);
-
-void alloc_block(arena_t *arena, const uint64_t address, const uint64_t size);
-void free_block(arena_t *arena, const uint64_t address);
-
-void read(arena_t *arena, uint64_t address, uint64_t size);
-char *create_string(uint64_t size);
-void write(arena_t *arena, const uint64_t address, const uint64_t size,
-		   int8_t *data);
-void pmap(const arena_t *arena);
-void mprotect(arena_t *arena, uint64_t address, int8_t *permission);
+avl_node_t *cases_of_alloc_block(arena_t *arena, avl_node_t *prev_node,
+								 avl_node_t *next_node, block_t *new_block,
+								 uint64_t end_address_new);
+void init_new_block(block_t *new_block, uint64_t address, uint64_t size);
+
+int alloc_block(arena_t *arena, const uint64_t address, const uint64_t size);
+int alloc_auto(arena_t *arena, uint64_t size, uint64_t align, int fit,
+			   uint64_t *address);
+int free_block(arena_t *arena, const uint64_t address);
+
+int read_source(arena_t *arena, const uint64_t address, const uint64_t size,
+				uint64_t *to_read);
+void read(arena_t *arena, uint64_t address, uint64_t size, FILE *out);
+void release_range(arena_t *arena, uint64_t address, uint64_t size);
+void output_zone(const arena_t *arena, uint64_t address, uint64_t size,
+				 FILE *out);
+void print_zone(const arena_t *arena, uint64_t address, uint64_t size,
+				FILE *out);
+void read_payload(input_t *in, const char *rest, uint64_t rest_len,
+				  uint8_t *dest, uint64_t to_write, uint64_t size);
+void read_payload_from(input_t *in, const char *rest, uint64_t rest_len,
+					   uint64_t offset, uint8_t *dest, uint64_t to_write,
+					   uint64_t size);
+int write_destination(arena_t *arena, const uint64_t address,
+					  const uint64_t size, uint8_t **dest, uint64_t *to_write);
+int write(arena_t *arena, const uint64_t address, const uint64_t size,
+		  const int8_t *data);
+void pmap(arena_t *arena, int verbose, FILE *out);
+int arena_stats(arena_t *arena, arena_stats_t *stats);
+void print_stats(arena_t *arena, FILE *out);
+int mprotect(arena_t *arena, uint64_t address, uint8_t perm);
+int mprotect_range(arena_t *arena, uint64_t address, uint64_t size,
+				   uint8_t perm);
 
 int transform_permission(char *data);
 int find_permission(int8_t *permission);
-block_t *find_block(arena_t *arena, const uint64_t address, unsigned int *idx);
-int check_permission(list_t *minib_list, node_t *minib_node, uint64_t size,
-					 int j, int mode);
-void print_permissions(uint8_t permissions);
+block_t *find_block(arena_t *arena, const uint64_t address,
+					avl_node_t **node);
+node_t *find_miniblock(arena_t *arena, const uint64_t address);
+void index_miniblock(arena_t *arena, node_t *minib_node);
+void unindex_miniblock(arena_t *arena, const uint64_t address);
+int check_permission(node_t *minib_node, uint64_t address, uint64_t size,
+					 int mode);
+void print_permissions(uint8_t permissions, FILE *out);
 
 // ===== Auxiliary functions =====
-int command_type(char *command);
-int nr_of_parameters(char *line, char *delim);
-int check_parameters(int type, int nr_param);
+void parse_command(char *line, size_t len, command_t *cmd);
+int command_type(const char *command, size_t len);
+int fit_type(const char *word, size_t len);
+int engine_type(const char *word, size_t len);
+uint64_t parse_number(const char *word, size_t len);
+uint64_t command_number(const command_t *cmd, int idx);
+int print_status(int status, const char *action, uint64_t size, FILE *out);
+int check_parameters(int type, int nr_param, FILE *out);